@@ -0,0 +1,106 @@
+/*
+   Copyright (c) 2021 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+/* Time the partial Gaussian elimination of random (n - k) x (n + 1) matrices
+ * with k = n / 2, as done in 'choose_is', using 1 to 'MAX_TABLES' Gray code
+ * tables, with the rows allocated one by one or in one slab. The table count
+ * picked by 'matrix_opt_tables' is marked with '*'. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bits.h"
+#include "matrix.h"
+#include "xoroshiro128plus.h"
+
+#define NB_RUNS 20
+#define L 16
+
+/* Best time of the elimination of copies of 'A0' in 'A'. */
+static long time_echelonize(matrix_t A, matrix_t A0, size_t rows, size_t cols,
+                            size_t k, size_t nb_tables, uint64_t *xor_rows,
+                            int **rev, int **diff) {
+  size_t row_bytes = AVX_PADDING(cols) / 8;
+  long best = -1;
+  for (size_t run = 0; run < NB_RUNS; ++run) {
+    for (size_t i = 0; i < rows; ++i) memcpy(A[i], A0[i], row_bytes);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    matrix_echelonize_partial(A, rows, cols, k, nb_tables, rows - L, xor_rows,
+                              rev, diff);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long time = (end.tv_sec - start.tv_sec) * (long)1e9 +
+                (end.tv_nsec - start.tv_nsec);
+    if (best < 0 || time < best) best = time;
+  }
+  return best;
+}
+
+int main(void) {
+  uint64_t S0, S1;
+  if (!seed_random(&S0, &S1)) exit(EXIT_FAILURE);
+
+  int **rev, **diff;
+  matrix_alloc_gray_code(&rev, &diff);
+  matrix_build_gray_code(rev, diff);
+
+  const size_t sizes[] = {300, 600, 1200, 2400, 3600, 4800, 6000, 7200};
+  printf("%6s %6s %7s %4s %12s %12s\n", "n", "rows", "tables", "k",
+         "rows (ns)", "slab (ns)");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    size_t n = sizes[s];
+    size_t rows = n - n / 2;
+    size_t cols = n + 1;
+    size_t opt_tables = matrix_opt_tables(rows, cols);
+
+    matrix_t A0 = matrix_alloc(rows, cols);
+    matrix_t A = matrix_alloc(rows, cols);
+    matrix_t A_slab = matrix_alloc_slab(rows, cols);
+    matrix_reset(A0, rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+      for (size_t j = 0; j < cols; ++j)
+        A0[i][j / WORD_SIZE] |= random_lim(1, &S0, &S1) << (j % WORD_SIZE);
+
+    const size_t nb_tables[] = {1, 2, 4, MAX_TABLES};
+    for (size_t t = 0; t < sizeof(nb_tables) / sizeof(nb_tables[0]); ++t) {
+      size_t k = matrix_opt_k(rows, cols, nb_tables[t]);
+      uint64_t *xor_rows =
+          aligned_alloc(32, matrix_tables_size(k, nb_tables[t], cols));
+
+      long t_rows = time_echelonize(A, A0, rows, cols, k, nb_tables[t],
+                                    xor_rows, rev, diff);
+      long t_slab = time_echelonize(A_slab, A0, rows, cols, k, nb_tables[t],
+                                    xor_rows, rev, diff);
+
+      printf("%6ld %6ld %6ld%c %4ld %12ld %12ld\n", n, rows, nb_tables[t],
+             nb_tables[t] == opt_tables ? '*' : ' ', k, t_rows, t_slab);
+      free(xor_rows);
+    }
+
+    matrix_free(A0, rows);
+    matrix_free(A, rows);
+    matrix_free_slab(A_slab, rows);
+  }
+
+  matrix_free_gray_code(rev, diff);
+  exit(EXIT_SUCCESS);
+}
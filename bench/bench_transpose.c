@@ -0,0 +1,158 @@
+/*
+   Copyright (c) 2021 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+/* Compare the transposition kernels on matrices shaped like the ones used in
+ * 'dumer' ((n - k + 1) x n with k = n / 2), then the storage of their rows:
+ * one allocation per row, one slab, or one slab compacted after the rows were
+ * shuffled as in 'choose_is'. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "matrix.h"
+#include "transpose.h"
+#include "xoroshiro128plus.h"
+
+#define NB_RUNS 200
+#define L 16
+
+typedef void (*transpose_fn)(matrix_t, const matrix_t, const size_t,
+                             const size_t);
+
+static long time_transpose(transpose_fn f, matrix_t At, matrix_t A,
+                           size_t nrows, size_t ncols) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < NB_RUNS; ++i) f(At, A, nrows, ncols);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec - start.tv_sec) * (long)1e9 +
+          (end.tv_nsec - start.tv_nsec)) /
+         NB_RUNS;
+}
+
+/* Swap rows of 'At' as 'shuffle_matrix' does, moving 'n_stop' random ones to
+ * the front. */
+static void shuffle_rows(matrix_t At, size_t n, size_t n_stop, uint64_t *S0,
+                         uint64_t *S1) {
+  for (size_t i = 0; i < n_stop; ++i) {
+    matrix_swap_rows(At, i, n_stop + random_lim(n - n_stop - 1, S0, S1));
+  }
+}
+
+/*
+ * Time the two transpositions of an iteration (At to A, then back) after the
+ * rows of At were shuffled, with the rows of both matrices allocated one by
+ * one (0), in one slab (1), or in one slab with At compacted first (2).
+ */
+static long time_storage(int storage, size_t n, size_t nrows, uint64_t *S0,
+                         uint64_t *S1) {
+  size_t ncols = n + 1;
+  matrix_t A, At;
+  if (storage) {
+    A = matrix_alloc_slab(nrows + 64, ncols);
+    At = matrix_alloc_slab(ncols + 64, nrows + 64);
+  } else {
+    A = matrix_alloc(nrows + 64, ncols);
+    At = matrix_alloc(ncols + 64, nrows + 64);
+  }
+  matrix_reset(A, nrows + 64, ncols);
+  matrix_reset(At, ncols + 64, nrows + 64);
+  for (size_t i = 0; i < ncols; ++i)
+    for (size_t j = 0; j < nrows; ++j)
+      At[i + 32][j / WORD_SIZE] |= random_lim(1, S0, S1) << (j % WORD_SIZE);
+
+  long time = 0;
+  for (size_t run = 0; run < NB_RUNS; ++run) {
+    shuffle_rows(At + 32, n, nrows - L, S0, S1);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (storage == 2) matrix_compact(At, ncols + 64, nrows + 64);
+    matrix_transpose_rev_rows(A + 32, At + 32, ncols, nrows);
+    matrix_transpose_rev_cols(At + 32, A + 32, nrows, ncols);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    time += (end.tv_sec - start.tv_sec) * (long)1e9 +
+            (end.tv_nsec - start.tv_nsec);
+  }
+
+  if (storage) {
+    matrix_free_slab(A, nrows + 64);
+    matrix_free_slab(At, ncols + 64);
+  } else {
+    matrix_free(A, nrows + 64);
+    matrix_free(At, ncols + 64);
+  }
+  return time / NB_RUNS;
+}
+
+int main(void) {
+  uint64_t S0, S1;
+  if (!seed_random(&S0, &S1)) exit(EXIT_FAILURE);
+
+  printf("%6s %6s %12s %12s %8s\n", "n", "rows", "32x8 (ns)", "64x64 (ns)",
+         "speedup");
+  for (size_t n = 300; n <= 3000; n += 300) {
+    size_t nrows = n - n / 2 + 1;
+    size_t ncols = n;
+
+    /* Same padding as in 'alloc_isd'. */
+    matrix_t A = matrix_alloc(nrows + 64, ncols);
+    matrix_t At_ref = matrix_alloc(ncols + 64, nrows + 64);
+    matrix_t At = matrix_alloc(ncols + 64, nrows + 64);
+    matrix_reset(A, nrows + 64, ncols);
+    matrix_reset(At_ref, ncols + 64, nrows + 64);
+    matrix_reset(At, ncols + 64, nrows + 64);
+    for (size_t i = 0; i < nrows; ++i)
+      for (size_t j = 0; j < ncols; ++j)
+        A[i][j / WORD_SIZE] |= random_lim(1, &S0, &S1) << (j % WORD_SIZE);
+
+    long t_ref = time_transpose(matrix_transpose_32x8, At_ref, A, nrows, ncols);
+    long t_new = time_transpose(matrix_transpose, At, A, nrows, ncols);
+
+    for (size_t i = 0; i < ncols; ++i) {
+      for (size_t j = 0; j < (nrows + WORD_SIZE - 1) / WORD_SIZE; ++j) {
+        if (At[i][j] != At_ref[i][j]) {
+          fprintf(stderr, "Mismatch at n=%ld, row %ld.\n", n, i);
+          exit(EXIT_FAILURE);
+        }
+      }
+    }
+
+    printf("%6ld %6ld %12ld %12ld %8.2f\n", n, nrows, t_ref, t_new,
+           (double)t_ref / t_new);
+
+    matrix_free(A, nrows + 64);
+    matrix_free(At_ref, ncols + 64);
+    matrix_free(At, ncols + 64);
+  }
+
+  printf("\n%6s %6s %12s %12s %12s\n", "n", "rows", "rows (ns)", "slab (ns)",
+         "compact (ns)");
+  for (size_t n = 600; n <= 6000; n += 600) {
+    size_t nrows = n - n / 2;
+    long t_rows = time_storage(0, n, nrows, &S0, &S1);
+    long t_slab = time_storage(1, n, nrows, &S0, &S1);
+    long t_compact = time_storage(2, n, nrows, &S0, &S1);
+    printf("%6ld %6ld %12ld %12ld %12ld\n", n, nrows, t_rows, t_slab,
+           t_compact);
+  }
+
+  exit(EXIT_SUCCESS);
+}
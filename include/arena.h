@@ -0,0 +1,66 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* Alignment of the blocks carved out of an arena (one cache line). */
+#define ARENA_ALIGN 64
+
+/*
+ * One mapping the buffers of a thread (or a set of tables) are carved out of,
+ * so that they are allocated, faulted in and freed at once, and can be backed
+ * by huge pages.
+ *
+ * An arena without memory ('base' NULL, as zero-initialized) only counts the
+ * bytes carved out of it, to size the real one.
+ */
+struct arena {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  /* Size of the pages backing the arena, and whether they are reserved huge
+   * pages (MAP_HUGETLB) rather than transparent ones. */
+  size_t page_size;
+  int hugetlb;
+};
+typedef struct arena *arena_t;
+
+/*
+ * Map 'size' bytes, on reserved huge pages if there are enough of them,
+ * otherwise on transparent huge pages if the kernel allows them, otherwise on
+ * normal pages. If 'prefault' is set, the pages are touched at once by the
+ * calling thread (so they are on its NUMA node). Return NULL on failure.
+ */
+arena_t alloc_arena(size_t size, int prefault);
+void free_arena(arena_t arena);
+/* Largest mapping 'alloc_arena' makes for 'size' bytes. */
+size_t arena_mapped_size(size_t size);
+/*
+ * Next 'size' bytes of the arena, aligned on ARENA_ALIGN bytes. Return NULL
+ * if it is full or has no memory.
+ */
+void *arena_alloc(arena_t arena, size_t size);
+/* Whether 'ptr' points in the arena. */
+int arena_owns(arena_t arena, const void *ptr);
+#endif /* ARENA_H */
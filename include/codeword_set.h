@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef CODEWORD_SET_H
+#define CODEWORD_SET_H
+#include <omp.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of independently locked parts of a set. */
+#define CODEWORD_SET_SHARDS 256
+
+struct codeword_set_shard {
+  omp_lock_t lock;
+  size_t nb;
+  size_t size;
+  /* Hashes of the supports, 0 for an empty slot. */
+  uint64_t *hashes;
+  /* Supports, 'w' positions per slot. */
+  uint32_t *supports;
+};
+
+/* Set of codewords of weight at most 'w', given by their support. */
+struct codeword_set {
+  size_t w;
+  struct codeword_set_shard shards[CODEWORD_SET_SHARDS];
+};
+typedef struct codeword_set *codeword_set_t;
+
+codeword_set_t codeword_set_alloc(size_t w);
+void codeword_set_free(codeword_set_t set);
+void codeword_set_clear(codeword_set_t set);
+int codeword_set_insert(codeword_set_t set, const uint32_t *support);
+#endif /* CODEWORD_SET_H */
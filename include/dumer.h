@@ -26,7 +26,11 @@
 #define TOKEN_CAT(x, y) x##y
 #define XTOKEN_CAT(x, y) TOKEN_CAT(x, y)
 
+#include "arena.h"
+#include "codeword_set.h"
 #include "matrix.h"
+#include "profile.h"
+#include "trace.h"
 
 #ifndef DUMER_L
 #define DUMER_L 16L
@@ -34,7 +38,9 @@
 #ifndef DUMER_P
 #define DUMER_P 4L
 #endif
+#ifndef DUMER_P1
 #define DUMER_P1 (DUMER_P / 2)
+#endif
 #define DUMER_P2 (DUMER_P - DUMER_P1)
 #ifndef DUMER_EPS
 #define DUMER_EPS 40L
@@ -45,9 +51,39 @@
 #ifndef DUMER_LW
 #define DUMER_LW 0
 #endif
+#ifndef DUMER_LW_STREAM
+#define DUMER_LW_STREAM 0
+#endif
+#ifndef DUMER_MULTI
+#define DUMER_MULTI 0
+#endif
+#ifndef DUMER_BATCH
+#define DUMER_BATCH 0
+#endif
 #ifndef DUMER_LUT
 #define DUMER_LUT 11L
 #endif
+#ifndef DUMER_ELIM_THREADS
+#define DUMER_ELIM_THREADS 1L
+#endif
+#ifndef DUMER_PIPELINE
+#define DUMER_PIPELINE 0
+#endif
+#ifndef DUMER_GENERIC
+#define DUMER_GENERIC 0
+#endif
+#ifndef DUMER_NUMA
+#define DUMER_NUMA 0
+#endif
+#ifndef DUMER_PREFAULT
+#define DUMER_PREFAULT 0
+#endif
+#ifndef DUMER_PROFILE
+#define DUMER_PROFILE 0
+#endif
+#ifndef DUMER_TRACE
+#define DUMER_TRACE 0
+#endif
 #if (DUMER_LUT) > (DUMER_L)
 #undef DUMER_LUT
 #define DUMER_LUT (DUMER_L)
@@ -55,13 +91,34 @@
 #ifndef DUMER_LUT_SHIFT
 #define DUMER_LUT_SHIFT ((DUMER_L) - (DUMER_LUT))
 #endif
-#if DUMER_P < 4 || DUMER_P > 8
-#error "No implementation for this value of DUMER_P"
+#if DUMER_P < 2
+#error "DUMER_P should be greater than 1"
+#endif
+#if DUMER_P1 < 1 || DUMER_P1 >= DUMER_P
+#error "DUMER_P1 should be between 1 and DUMER_P - 1"
 #endif
 #if DUMER_L < 1
 #error "DUMER_L should be greater than 0"
 #endif
-#if DUMER_L > 64
+#if DUMER_ELIM_THREADS < 1
+#error "DUMER_ELIM_THREADS should be greater than 0"
+#endif
+#if DUMER_TRACE < 0
+#error "DUMER_TRACE should be a number of events"
+#endif
+#if DUMER_LW_STREAM && !(DUMER_LW)
+#error "DUMER_LW_STREAM can only be used with DUMER_LW"
+#endif
+#if DUMER_MULTI && (DUMER_DOOM || DUMER_LW)
+#error "DUMER_MULTI cannot be used with DUMER_DOOM or DUMER_LW"
+#endif
+#if DUMER_BATCH && (DUMER_DOOM || DUMER_LW || DUMER_MULTI)
+#error "DUMER_BATCH cannot be used with DUMER_DOOM, DUMER_LW or DUMER_MULTI"
+#endif
+#if DUMER_PIPELINE && DUMER_ELIM_THREADS > 1
+#error "DUMER_PIPELINE cannot be used with DUMER_ELIM_THREADS"
+#endif
+#if DUMER_L > 128
 #error "No implementation for this value of DUMER_L"
 #endif
 
@@ -85,9 +142,18 @@
 #define SORT_WIDTH 64
 #define LIST_TYPE uint64_t
 #define SORT_TYPE uint64_t
+#elif DUMER_L <= 128
+#define LIST_WIDTH 128
+#define SORT_WIDTH 128
+#define LIST_TYPE unsigned __int128
+#define SORT_TYPE unsigned __int128
 #endif
 #if DUMER_L == 64
 #define DUMER_L_MASK (~0UL)
+#elif DUMER_L == 128
+#define DUMER_L_MASK (~(LIST_TYPE)0)
+#elif DUMER_L > 64
+#define DUMER_L_MASK ((((LIST_TYPE)1) << DUMER_L) - 1)
 #else
 #define DUMER_L_MASK ((uint64_t)((1UL << DUMER_L) - 1))
 #endif
@@ -95,29 +161,78 @@
 
 enum type { QC, SD, LW, GO };
 
-struct shared {
-  uint16_t *list1_pos;
+/*
+ * Called on each solution, one thread at a time, with the index of the
+ * decoded syndrome (0 if there is only one), the weight of the error pattern
+ * (or codeword) and the pattern itself. A non-zero return value stops the
+ * search.
+ */
+typedef int (*solution_callback_t)(void *arg, size_t target, size_t weight,
+                                   const uint8_t *solution);
+
+/* Number of bits of the rank used to guess the positions of list1. */
+#define UNRANK1_BITS 10
+
+/* Tables never written once built, so that each NUMA node can have a copy. */
+struct tables {
+  /* Where the tables (and this structure) are carved out of. */
+  arena_t arena;
+  /* Binomial coefficients to unrank the combinations of list1. */
+  uint64_t *binomials1;
+  size_t unrank1_shift;
+  uint16_t unrank1_guess[(1 << UNRANK1_BITS) + 1];
+  int **gray_rev;
+  int **gray_diff;
+};
 
-  uint16_t *combinations2;
-  uint16_t *combinations2_diff;
+struct shared {
+  struct tables *tables;
 
   uint64_t nb_combinations1;
-  uint64_t nb_combinations2;
+  /* Length of list1, which holds the combinations for each target. */
+  uint64_t len_list1;
+  /* Number of syndromes extending the parity-check matrix (without DOOM). */
+  size_t nb_targets;
+#if DUMER_BATCH
+  /* Syndromes already decoded by any thread. */
+  atomic_int *solved;
+  atomic_size_t nb_solved;
+#elif !(DUMER_LW)
+  /* Whether the solution was reported by any thread. */
+  atomic_int reported;
+#endif
 
-#if DUMER_LW
-  omp_lock_t w_best_lock;
-  size_t w_best;
+#if DUMER_LW_STREAM
+  /* Codewords already output. */
+  codeword_set_t codewords;
+  /* Set when a codeword could not be recorded, which stops the search. */
+  atomic_int error;
+#elif DUMER_LW
+  /* Weight of the best codeword found by any thread. */
+  atomic_size_t w_best;
 #endif
-  int **gray_rev;
-  int **gray_diff;
   size_t k_opt;
+  size_t nb_tables;
+
+  /* Set to stop all the threads, polled during the collision search. */
+  atomic_int stop;
+  /* Length of the mapping holding this structure if it is shared. */
+  size_t len_shared;
 };
 
 struct isd {
   matrix_t A;
   matrix_t At;
+  /* Tables of the search, or their copy on the NUMA node of the thread. */
+  const struct tables *tables;
+  /* Where A, At and the buffers of the thread are carved out of. */
+  arena_t arena;
 
   size_t *perm;
+#if DUMER_PIPELINE
+  /* Permutation of the information set being searched. */
+  size_t *perm_is;
+#endif
   /* Seeds for pseudo random number generator. */
   uint64_t S0;
   uint64_t S1;
@@ -141,10 +256,19 @@ struct isd {
 #if !(DUMER_LW)
   uint64_t *s_full;
 #endif
+  size_t nb_targets;
 
   size_t w_target;
   size_t w_solution;
   uint8_t *solution;
+  solution_callback_t callback;
+  void *callback_arg;
+  /* Time (omp_get_wtime) at which the search stops, or 0 for no limit. */
+  double deadline;
+#if DUMER_MULTI || DUMER_BATCH
+  /* Index of the decoded syndrome. */
+  size_t target;
+#endif
 
   /* Avoid mallocing and freeing all the time. */
 
@@ -160,21 +284,142 @@ struct isd {
   uint64_t *xor_pairs;
 
   uint64_t *xor_rows;
+
+#if (DUMER_ELIM_THREADS) > 1
+  struct team *team;
+  size_t team_id;
+#endif
+
+#if DUMER_PROFILE
+  /* Time and events of the thread. */
+  struct profile profile;
+#endif
+#if DUMER_TRACE
+  /* Last phases of the thread. */
+  struct trace trace;
+#endif
+};
+
+#if (DUMER_ELIM_THREADS) > 1
+/* Threads doing their Gaussian eliminations together. */
+struct team {
+  struct matrix_team elim;
+  struct isd *isd[DUMER_ELIM_THREADS];
+  /* Whether the team leaves the search, decided by its first thread. */
+  int stop;
+};
+typedef struct team *team_t;
+#endif
+
+#if DUMER_PIPELINE
+/* Columns extracted from an information set. */
+struct slot {
+  LIST_TYPE *columns1_low;
+  uint64_t *columns1_full;
+  uint64_t *columns2_full;
+#if !(DUMER_LW)
+  uint64_t *s_full;
+#endif
+  size_t *perm;
+};
+
+/* Information sets prepared by some threads and searched by others. */
+struct pipeline {
+  omp_lock_t lock;
+  size_t nb_slots;
+  struct slot *slots;
+  /* Stack of free slots. */
+  size_t *free;
+  size_t nb_free;
+  /* Ring of slots ready to be searched. */
+  size_t *ready;
+  size_t ready_head;
+  size_t nb_ready;
+
+  /* Where the buffers of the slots are carved out of. */
+  arena_t arena;
+
+  size_t nb_threads;
+  /* Threads of the pipeline, which may hold buffers of the slots. */
+  struct isd **isd;
+  /* Average durations (in seconds) of both steps. */
+  double time_prepare;
+  double time_search;
+  uint64_t nb_searched;
+};
+typedef struct pipeline *pipeline_t;
+#endif
+
+/*
+ * Matrix A of an instance, extended with its syndromes, and its transpose
+ * At, built once and copied by each thread.
+ */
+struct instance {
+  matrix_t A;
+  matrix_t At;
+  size_t r;
+  size_t nb_cols;
+};
+
+/* Bytes of the data of one thread, by part. */
+struct isd_memory {
+  /* A and At. */
+  size_t matrices;
+  /* list1, the buffers sorting it, its LUT and the scratch building it. */
+  size_t list1;
+  /* Columns of the information set and syndromes the search reads. */
+  size_t columns;
+  /* Gray code tables of the elimination. */
+  size_t xor_rows;
+  /* Permutation, vectors of the collision search and solution. */
+  size_t other;
+  /* All of them as mapped, with the structure. */
+  size_t total;
 };
 
 typedef struct isd *isd_t;
 typedef struct shared *shr_t;
+typedef struct instance *instance_t;
 
-shr_t alloc_shr(size_t n1, size_t n2);
+struct tables *alloc_tables(size_t n1);
+void free_tables(struct tables *tables);
+/* Bytes 'alloc_tables' maps. */
+size_t tables_size(size_t n1);
+void build_tables(struct tables *tables, size_t n1);
+shr_t alloc_shr(size_t n1, size_t n2, size_t nb_targets);
 void free_shr(shr_t shr);
+void reset_shr(shr_t shr);
+shr_t share_shr(shr_t shr);
 void init_shr(shr_t shr, size_t n, size_t k, size_t n1, size_t n2);
 isd_t alloc_isd(size_t n, size_t k, size_t r, size_t n1, size_t n2,
-                uint64_t nb_combinations1, size_t k_opt);
-void free_isd(isd_t isd, size_t r, size_t n);
-void init_isd(isd_t isd, enum type current_type, size_t n, size_t k, size_t w,
-              uint8_t *mat_h, uint8_t *mat_s);
+                uint64_t len_list1, size_t nb_targets, size_t k_opt,
+                size_t nb_tables);
+void free_isd(isd_t isd);
+/* Bytes 'alloc_isd' will take, computed without allocating them. */
+void plan_isd(struct isd_memory *memory, size_t n, size_t k, size_t n1,
+              size_t n2, size_t nb_targets);
+#if DUMER_PIPELINE
+pipeline_t alloc_pipeline(size_t nb_threads, size_t k, size_t r, size_t n1,
+                          size_t n2, size_t nb_targets);
+void free_pipeline(pipeline_t pipe);
+size_t pipeline_size(size_t nb_threads, size_t k, size_t r, size_t n1,
+                     size_t n2, size_t nb_targets);
+int dumer_pipeline(size_t n, size_t k, size_t r, size_t n1, size_t n2,
+                   shr_t shr, pipeline_t pipe, isd_t isd, size_t thread);
+uint64_t pipeline_nb_searched(pipeline_t pipe);
+#endif
+#if (DUMER_ELIM_THREADS) > 1
+team_t alloc_teams(size_t nb_teams);
+void join_team(isd_t isd, team_t teams, size_t thread);
+#endif
+instance_t alloc_instance(size_t n, size_t k, size_t nb_targets);
+void free_instance(instance_t inst);
+size_t instance_size(size_t n, size_t k, size_t nb_targets);
+int build_instance(instance_t inst, enum type current_type, size_t n, size_t k,
+                   const uint64_t *mat_h, const uint64_t *mat_s);
+void init_isd(isd_t isd, const instance_t inst, size_t n, size_t w);
 
 int dumer(size_t n, size_t k, size_t r, size_t n1, size_t n2, shr_t shr,
           isd_t isd);
-void print_solution(size_t n, isd_t isd);
+void report_solution(shr_t shr, isd_t isd);
 #endif /* DUMER_H */
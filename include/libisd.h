@@ -0,0 +1,195 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef LIBISD_H
+#define LIBISD_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dumer.h"
+#include "topology.h"
+
+/*
+ * An instance and the data computed only once to solve it.
+ *
+ * The instances are given as packed lines of bits by 'parse_buffer': 'mat_h'
+ * holds the k columns of the redundant part of H (only its first row for
+ * QC), 'mat_s' the 'nb_targets' syndromes.
+ */
+struct solver {
+  enum type type;
+  size_t n;
+  size_t k;
+  size_t w;
+  size_t n1;
+  size_t n2;
+  size_t nb_targets;
+  instance_t instance;
+  shr_t shr;
+  /* Data of each thread, kept from one run to the next. */
+  size_t nb_threads;
+  isd_t *isd;
+  /* Information sets searched during the last run. */
+  uint64_t nb_iterations;
+#if DUMER_PROFILE
+  /* Time and events of all the threads during the last run. */
+  struct profile profile;
+#endif
+  /* Start of the random stream of the threads, if given by 'seed_solver'. */
+  int seeded;
+  uint64_t S0;
+  uint64_t S1;
+#if DUMER_NUMA
+  /*
+   * CPUs of the threads, from 'first_cpu' on (so that several processes can
+   * share them out), and a copy of the tables of 'shr' on each node.
+   */
+  topology_t topology;
+  size_t first_cpu;
+  struct tables **replicas;
+#endif
+};
+typedef struct solver *solver_t;
+
+/* Number of solvers kept by a cache. */
+#define SOLVER_CACHE_SIZE 16
+
+/* Solvers of the last instances, the most recently used first. */
+struct solver_cache {
+  size_t nb_solvers;
+  solver_t solvers[SOLVER_CACHE_SIZE];
+};
+typedef struct solver_cache *solver_cache_t;
+
+/*
+ * Copy an instance. 'n1' is the number of columns list1 is built from, or 0
+ * for half of them. Return NULL if the parameters do not fit the instance.
+ */
+solver_t alloc_solver(enum type type, size_t n, size_t k, size_t w,
+                      const uint64_t *mat_h, const uint64_t *mat_s,
+                      size_t nb_targets, size_t n1);
+void free_solver(solver_t solver);
+
+/* Memory taken by a solver, computed before anything is allocated. */
+struct solver_memory {
+  size_t n;
+  size_t k;
+  size_t n1;
+  size_t n2;
+  size_t nb_targets;
+  /* A and At of the instance, and the structures holding the solver. */
+  size_t shared;
+  /* Tables of the search, copied on each of 'nb_nodes' nodes (DUMER_NUMA). */
+  size_t tables;
+  size_t nb_nodes;
+  /* Data of each thread. */
+  struct isd_memory thread;
+};
+
+/*
+ * Compute the memory 'alloc_solver' and 'run_solver' would take for an
+ * instance. Return 0 if the parameters do not fit the instance.
+ */
+int plan_solver(struct solver_memory *memory, size_t n, size_t k,
+                size_t nb_targets, size_t n1);
+/*
+ * Bytes taken by 'nb_threads' threads in each of 'nb_procs' processes
+ * (forked once the solver is built, see 'share_solver'), with the data they
+ * share.
+ */
+size_t plan_total(const struct solver_memory *memory, size_t nb_threads,
+                  size_t nb_procs);
+/*
+ * Largest number of threads, a multiple of DUMER_ELIM_THREADS up to
+ * 'max_threads', for which 'plan_total' fits in 'limit' bytes, or 0.
+ */
+size_t plan_threads(const struct solver_memory *memory, size_t max_threads,
+                    size_t nb_procs, size_t limit);
+
+/*
+ * Replace the instance by another one with the same length, dimension and
+ * number of syndromes, reusing everything already allocated or computed.
+ * Return 0 if the type cannot be decoded or on allocation error.
+ */
+int load_solver(solver_t solver, enum type type, size_t w,
+                const uint64_t *mat_h, const uint64_t *mat_s);
+
+/*
+ * Search with 'nb_threads' threads, for at most 'timeout' seconds (no limit
+ * if it is not positive), handing the solutions to 'callback'.
+ *
+ * Return 1 once the instance is solved, 0 when the search was stopped
+ * (timeout, 'cancel_solver' or callback) and -1 on error. Syndromes decoded
+ * (DUMER_BATCH) and codewords found (DUMER_LW) by a previous run are not
+ * reported again.
+ */
+int run_solver(solver_t solver, size_t nb_threads, double timeout,
+               solution_callback_t callback, void *arg);
+
+/*
+ * Size of the smallest pages backing the data of the threads (huge pages when
+ * available, see 'alloc_arena'), or 0 before the first run.
+ */
+size_t solver_page_size(solver_t solver);
+
+#if DUMER_TRACE
+/*
+ * Write the last phases recorded by each thread (see 'write_trace'), the
+ * threads being numbered from 0 in the calling process, then forget them.
+ * Return 0 on failure.
+ */
+int write_solver_trace(solver_t solver, FILE *file);
+#endif
+
+/* Stop the current run from any thread. */
+void cancel_solver(solver_t solver);
+
+/*
+ * Draw the information sets of the threads from disjoint parts of the random
+ * stream seeded by 'S0' and 'S1': 2^96 draws apart for each 'stream' (say,
+ * one per process), then 2^64 apart for each thread. Otherwise each thread
+ * seeds itself from /dev/urandom.
+ */
+void seed_solver(solver_t solver, uint64_t S0, uint64_t S1, size_t stream);
+
+/*
+ * Share the state of the search with the processes forked afterwards: the
+ * first solution found by any of them stops them all and is reported once
+ * (DUMER_BATCH: each syndrome is decoded once, DUMER_LW: only codewords
+ * improving on the best weight found by any of them are reported). The
+ * processes should then only call 'run_solver' and 'cancel_solver', the
+ * state being reset by the next 'load_solver' of the parent.
+ *
+ * Return 0 on failure or with DUMER_LW_STREAM.
+ */
+int share_solver(solver_t solver);
+
+solver_cache_t alloc_solver_cache(void);
+void free_solver_cache(solver_cache_t cache);
+/*
+ * Same as 'alloc_solver', except that the solver belongs to the cache: it is
+ * reused for the next instances with the same length, dimension, number of
+ * syndromes and 'n1', until it is the least recently used of too many.
+ */
+solver_t cache_solver(solver_cache_t cache, enum type type, size_t n,
+                      size_t k, size_t w, const uint64_t *mat_h,
+                      const uint64_t *mat_s, size_t nb_targets, size_t n1);
+#endif /* LIBISD_H */
@@ -0,0 +1,80 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef PARSE_H
+#define PARSE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dumer.h"
+
+/* Start of a packed instance file, and suffix of those made by the cache. */
+#define PACKED_MAGIC "ISDPACK1"
+#define PACKED_SUFFIX ".pack"
+
+/*
+ * Header of a packed instance file. It is followed by the lines of 'mat_h',
+ * then by those of the 'nb_s' syndromes, as given by 'parse_buffer'. Being 64
+ * bytes long, it leaves them aligned as in memory in a mapping of the file.
+ */
+struct packed_header {
+  char magic[8];
+  uint64_t type;
+  uint64_t n;
+  uint64_t k;
+  uint64_t w;
+  uint64_t seed;
+  uint64_t nb_s;
+  uint64_t reserved;
+};
+
+/*
+ * Parse an instance of the given type in the format of the decoding
+ * challenge from the 'len' bytes of 'buf', allocating 'mat_h' and the 'nb_s'
+ * syndromes of 'mat_s'. Both are packed lines of bits (bit 'i' of a line in
+ * bit 'i % 64' of its word 'i / 64'), each padded to a multiple of 256 bits:
+ * the 'k' columns of the redundant part of the parity-check matrix (only its
+ * first one for QC) and syndromes of 'n - k' bits. Packed instances are
+ * recognized by their header and copied as they are.
+ */
+int parse_buffer(enum type type, const char *buf, size_t len, size_t *n,
+                 size_t *k, size_t *w, uint64_t **mat_h, uint64_t **mat_s,
+                 size_t *nb_s);
+/* Same as 'parse_buffer' for the whole content of 'file'. */
+int parse_input(enum type type, FILE *file, size_t *n, size_t *k, size_t *w,
+                uint64_t **mat_h, uint64_t **mat_s, size_t *nb_s);
+/* Same as 'parse_buffer' for the file named 'filename', which is mapped. */
+int parse_file(enum type type, const char *filename, size_t *n, size_t *k,
+               size_t *w, uint64_t **mat_h, uint64_t **mat_s, size_t *nb_s);
+/*
+ * Write the instance of the file named 'filename' (of the given type) to
+ * 'packed', with all its syndromes.
+ */
+int pack_file(enum type type, const char *filename, const char *packed);
+/*
+ * Same as 'parse_file', reading FILENAME.pack instead when it is newer than
+ * the file, and writing it otherwise.
+ */
+int parse_file_cached(enum type type, const char *filename, size_t *n,
+                      size_t *k, size_t *w, uint64_t **mat_h,
+                      uint64_t **mat_s, size_t *nb_s);
+#endif /* PARSE_H */
@@ -0,0 +1,86 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Steps of an iteration whose time is measured (DUMER_PROFILE) or recorded
+ * (DUMER_TRACE).
+ */
+enum profile_phase {
+  /* Choice of the information set (choose_is). */
+  PROFILE_SHUFFLE,
+  PROFILE_TRANSPOSE,
+  PROFILE_ECHELONIZE,
+  /* Extraction of the columns searched. */
+  PROFILE_EXTRACT,
+  /* Birthday decoding (search_is). */
+  PROFILE_BUILD_LIST,
+  PROFILE_SORT,
+  PROFILE_BUILD_LUT,
+  PROFILE_XOR_PAIRS,
+  PROFILE_FIND_COLLISIONS,
+  PROFILE_NB_PHASES
+};
+
+/* Events counted during the search. */
+enum profile_counter {
+  /* Information sets searched. */
+  PROFILE_ITERATIONS,
+  /* Elements of list2 enumerated (one XOR each). */
+  PROFILE_CHASE_STEPS,
+  /* Searches of an element of list2 in list1. */
+  PROFILE_LUT_PROBES,
+  /* Elements of list1 colliding on the DUMER_L bits. */
+  PROFILE_L_HITS,
+  /* Collisions whose error pattern was checked in full... */
+  PROFILE_FULL_CHECKS,
+  /* ...or rejected as soon as their syndrome weighed too much. */
+  PROFILE_EARLY_ABORTS,
+  PROFILE_NB_COUNTERS
+};
+
+/* Time (in nanoseconds) and events of one thread, or of several. */
+struct profile {
+  uint64_t time[PROFILE_NB_PHASES];
+  uint64_t count[PROFILE_NB_COUNTERS];
+};
+
+static inline uint64_t profile_clock(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000UL + now.tv_nsec;
+}
+
+/* Name of a phase in the JSON outputs. */
+const char *profile_phase_name(enum profile_phase phase);
+void clear_profile(struct profile *profile);
+void add_profile(struct profile *total, const struct profile *profile);
+/*
+ * Write a profile as a JSON object: the time of each phase, the counters and
+ * the parameters of the search. Return 0 on failure.
+ */
+int write_profile(const struct profile *profile, FILE *file);
+#endif /* PROFILE_H */
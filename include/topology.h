@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * CPUs the threads are pinned on, one per thread in turn, and their NUMA
+ * nodes (numbered from 0 in the order they are found).
+ */
+struct topology {
+  size_t nb_cpus;
+  int *cpus;
+  size_t *nodes;
+  size_t nb_nodes;
+};
+typedef struct topology *topology_t;
+
+/*
+ * Order the CPUs this process may run on so that consecutive threads are
+ * spread over the NUMA nodes by groups of 'group' (which stay on one node),
+ * using the first 'threads_per_core' hardware threads of each core. Each node
+ * gets one thread per core before getting a second one.
+ */
+topology_t alloc_topology(size_t threads_per_core, size_t group);
+void free_topology(topology_t topology);
+/* Pin the calling thread on its CPU and return the index of its node. */
+size_t pin_thread(topology_t topology, size_t thread);
+/* Print the CPUs of the threads 'first' to 'first + nb_threads - 1'. */
+void print_topology(topology_t topology, size_t first, size_t nb_threads,
+                    FILE *file);
+#endif /* TOPOLOGY_H */
@@ -0,0 +1,64 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#ifndef TRACE_H
+#define TRACE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "profile.h"
+
+/* One phase of an iteration, between two clock readings (in nanoseconds). */
+struct trace_event {
+  uint64_t begin;
+  uint64_t end;
+  enum profile_phase phase;
+};
+
+/*
+ * Ring of the last 'size' phases of a thread (DUMER_TRACE). Only its thread
+ * writes to it, so recording an event takes no lock; it is read once the
+ * threads are done.
+ */
+struct trace {
+  size_t size;
+  /* Events recorded so far, the oldest ones being overwritten. */
+  uint64_t nb_events;
+  struct trace_event *events;
+};
+
+static inline void trace_event(struct trace *trace, enum profile_phase phase,
+                               uint64_t begin, uint64_t end) {
+  struct trace_event *event = &trace->events[trace->nb_events % trace->size];
+  event->begin = begin;
+  event->end = end;
+  event->phase = phase;
+  ++trace->nb_events;
+}
+
+/*
+ * Write the events of the ring, oldest first, as Chrome trace events (the
+ * format also read by Perfetto) of thread 'tid' of process 'pid', each one
+ * preceded by a comma. Return 0 on failure.
+ */
+int write_trace(const struct trace *trace, long pid, size_t tid, FILE *file);
+#endif /* TRACE_H */
@@ -23,11 +23,18 @@
 #define TRANSPOSE_H
 #include "matrix.h"
 
+void matrix_transpose_32x8(matrix_t At, const matrix_t A, const size_t nrows,
+                           const size_t ncols);
+void matrix_transpose_block(matrix_t At, const matrix_t A, const size_t nrows,
+                            const size_t cstart, const size_t ncols);
 void matrix_transpose(matrix_t At, const matrix_t A, const size_t nrows,
                       const size_t ncols);
 void matrix_reverse_rows(matrix_t A, const size_t nrows);
 void matrix_transpose_rev_cols(matrix_t At, matrix_t A, const size_t nrows,
                                const size_t ncols);
+void matrix_transpose_rev_cols_echelon(matrix_t At, matrix_t A,
+                                       const size_t nrows, const size_t ncols,
+                                       const size_t npivots);
 void matrix_transpose_rev_rows(matrix_t At, matrix_t A, const size_t nrows,
                                const size_t ncols);
 #endif /* TRANSPOSE_H */
@@ -20,17 +20,38 @@
  ******************************************************************************/
 #ifndef MATRIX_H
 #define MATRIX_H
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 
-#define MAX_K 7
+#define MAX_K 10
+#define MAX_TABLES 8
 
 typedef uint64_t word_t;
 typedef word_t **matrix_t;
 
 #define WORD_SIZE (8 * sizeof(word_t))
 
+/* Group of threads sharing the elimination of one matrix. */
+struct matrix_team {
+  size_t size;
+  atomic_size_t count;
+  atomic_size_t phase;
+  /* Rank found by the first thread on the current block of columns. */
+  size_t kbar;
+};
+
 matrix_t matrix_alloc(size_t rows, size_t cols);
+/*
+ * Matrices whose rows are consecutive in one slab (with a spare row, then the
+ * row pointers). Swapping rows still swaps their pointers; 'matrix_compact'
+ * puts them back in order in memory.
+ */
+size_t matrix_slab_size(size_t rows, size_t cols);
+matrix_t matrix_slab(void *slab, size_t rows, size_t cols);
+matrix_t matrix_alloc_slab(size_t rows, size_t cols);
+void matrix_free_slab(matrix_t M, size_t rows);
+void matrix_compact(matrix_t M, size_t rows, size_t cols);
 void matrix_reset(matrix_t M, size_t rows, size_t cols);
 void matrix_free(matrix_t M, size_t rows);
 void matrix_swap_rows(matrix_t M, size_t i, size_t j);
@@ -41,7 +62,15 @@ void matrix_build_gray_code(int **rev, int **diff);
 size_t matrix_gauss_submatrix(matrix_t M, size_t r, size_t c, size_t rows,
                               size_t cols, size_t k);
 size_t matrix_echelonize_partial(matrix_t M, size_t rows, size_t cols, size_t k,
-                                 size_t rstop, uint64_t *xor_rows, int **rev,
-                                 int **diff);
-size_t matrix_opt_k(size_t a, size_t b);
+                                 size_t nb_tables, size_t rstop,
+                                 uint64_t *xor_rows, int **rev, int **diff);
+size_t matrix_echelonize_partial_team(matrix_t M, size_t rows, size_t cols,
+                                      size_t k, size_t nb_tables, size_t rstop,
+                                      uint64_t *xor_rows, int **rev, int **diff,
+                                      struct matrix_team *team, size_t id);
+void matrix_team_init(struct matrix_team *team, size_t size);
+void matrix_team_barrier(struct matrix_team *team);
+size_t matrix_opt_tables(size_t a, size_t b);
+size_t matrix_opt_k(size_t a, size_t b, size_t nb_tables);
+size_t matrix_tables_size(size_t k, size_t nb_tables, size_t cols);
 #endif /* MATRIX_H */
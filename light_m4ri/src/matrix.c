@@ -20,7 +20,12 @@
  ******************************************************************************/
 #include "matrix.h"
 
+#include <immintrin.h>
+#include <sched.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "bits.h"
 
@@ -33,6 +38,66 @@ matrix_t matrix_alloc(size_t rows, size_t cols) {
   return ret;
 }
 
+/* Rows of a slab, followed by a spare one and the row pointers. */
+static size_t slab_stride(size_t cols) {
+  return AVX_PADDING(cols) * sizeof(word_t) / WORD_SIZE;
+}
+
+size_t matrix_slab_size(size_t rows, size_t cols) {
+  return (rows + 1) * slab_stride(cols) + (rows + 1) * sizeof(word_t *);
+}
+
+matrix_t matrix_slab(void *slab, size_t rows, size_t cols) {
+  uint8_t *base = slab;
+  size_t stride = slab_stride(cols);
+  matrix_t ret = (matrix_t)(base + (rows + 1) * stride);
+  for (size_t i = 0; i < rows; ++i) {
+    ret[i] = (word_t *)(base + i * stride);
+  }
+  /* The start of the slab, for 'matrix_compact' and 'matrix_free_slab'. */
+  ret[rows] = (word_t *)base;
+  return ret;
+}
+
+matrix_t matrix_alloc_slab(size_t rows, size_t cols) {
+  size_t size = (matrix_slab_size(rows, cols) + 63) / 64 * 64;
+  void *slab = aligned_alloc(64, size);
+  if (!slab) return NULL;
+  return matrix_slab(slab, rows, cols);
+}
+
+void matrix_free_slab(matrix_t M, size_t rows) {
+  if (M) free(M[rows]);
+}
+
+/*
+ * Move the rows of a slab back in the order of their pointers, after they
+ * were swapped, so that consecutive rows are consecutive in memory again.
+ * Each cycle of the permutation of the rows goes through the spare row.
+ */
+void matrix_compact(matrix_t M, size_t rows, size_t cols) {
+  uint8_t *base = (uint8_t *)M[rows];
+  size_t stride = slab_stride(cols);
+  word_t *spare = (word_t *)(base + rows * stride);
+  for (size_t i = 0; i < rows; ++i) {
+    word_t *slot = (word_t *)(base + i * stride);
+    if (M[i] == slot) continue;
+    /* The slot of row 'i' is freed, then filled with its data. */
+    memcpy(spare, slot, stride);
+    word_t *free_slot = slot;
+    size_t j = i;
+    while (M[j] != slot) {
+      memcpy(free_slot, M[j], stride);
+      word_t *next = M[j];
+      M[j] = free_slot;
+      free_slot = next;
+      j = ((uint8_t *)free_slot - base) / stride;
+    }
+    memcpy(free_slot, spare, stride);
+    M[j] = free_slot;
+  }
+}
+
 void matrix_reset(matrix_t M, size_t rows, size_t cols) {
   for (size_t i = 0; i < rows; ++i) {
     for (size_t j = 0; j < (cols + WORD_SIZE - 1) / WORD_SIZE; ++j) {
@@ -153,25 +218,32 @@ void matrix_build_gray_code(int **rev, int **diff) {
   }
 }
 
+/* Echelonize the k x k submatrix starting at row 'r' and column 'c'.
+ *
+ * Rows from 'r' onwards are zero on the left of column 'c', so only the words
+ * from the AVX register holding column 'c' are updated. */
 size_t matrix_gauss_submatrix(matrix_t M, size_t r, size_t c, size_t rows,
                               size_t cols, size_t k) {
   size_t start_row = r;
   size_t j;
-  size_t cols_padded_ymm = AVX_PADDING(cols) / 256;
+  size_t start_word = c / 256 * 4;
+  size_t len_ymm = AVX_PADDING(cols) / 256 - c / 256;
   for (j = c; j < c + k; ++j) {
     int found = 0;
     for (size_t i = start_row; i < rows; ++i) {
       for (size_t l = 0; l < j - c; ++l)
         if ((M[i][(c + l) / WORD_SIZE] >> ((c + l) % WORD_SIZE)) & 1)
-          xor_avx1((uint8_t *)M[r + l], (uint8_t *)M[i], (uint8_t *)M[i],
-                   cols_padded_ymm);
+          xor_avx1((uint8_t *)(M[r + l] + start_word),
+                   (uint8_t *)(M[i] + start_word),
+                   (uint8_t *)(M[i] + start_word), len_ymm);
 
       if ((M[i][j / WORD_SIZE] >> (j % WORD_SIZE)) & 1) {
         matrix_swap_rows(M, i, start_row);
         for (size_t l = r; l < start_row; ++l) {
           if ((M[l][j / WORD_SIZE] >> (j % WORD_SIZE)) & 1)
-            xor_avx1((uint8_t *)M[start_row], (uint8_t *)M[l], (uint8_t *)M[l],
-                     cols_padded_ymm);
+            xor_avx1((uint8_t *)(M[start_row] + start_word),
+                     (uint8_t *)(M[l] + start_word),
+                     (uint8_t *)(M[l] + start_word), len_ymm);
         }
         ++start_row;
         found = 1;
@@ -185,19 +257,31 @@ size_t matrix_gauss_submatrix(matrix_t M, size_t r, size_t c, size_t rows,
   return j - c;
 }
 
-void matrix_make_table(matrix_t M, size_t r, size_t cols, size_t k, uint64_t *T,
-                       int **diff) {
+/* Size in bytes of the Gray code tables used by 'matrix_echelonize_partial'. */
+size_t matrix_tables_size(size_t k, size_t nb_tables, size_t cols) {
+  return nb_tables * (1UL << k) * AVX_PADDING(cols) / 8;
+}
+
+/* Build the table of all 2^k combinations of rows 'r' to 'r + k - 1', in Gray
+ * code order.
+ *
+ * These rows are zero on the left of column 'cstart', so only the words from
+ * the AVX register holding column 'cstart' are computed. */
+void matrix_make_table(matrix_t M, size_t r, size_t cstart, size_t cols,
+                       size_t k, uint64_t *T, int **diff) {
   size_t cols_padded = AVX_PADDING(cols);
   size_t cols_padded_word = cols_padded / 64;
-  size_t cols_padded_ymm = cols_padded / 256;
+  size_t start_word = cstart / 256 * 4;
+  size_t len_ymm = (cols_padded_word - start_word) / 4;
 
-  for (size_t i = 0; i < cols_padded_word; ++i) {
+  for (size_t i = start_word; i < cols_padded_word; ++i) {
     T[i] = 0L;
   }
 
   for (size_t i = 0; i + 1 < 1UL << k; ++i) {
-    xor_avx1((uint8_t *)M[r + diff[k][i]], (uint8_t *)T,
-             (uint8_t *)(T + cols_padded_word), cols_padded_ymm);
+    xor_avx1((uint8_t *)(M[r + diff[k][i]] + start_word),
+             (uint8_t *)(T + start_word),
+             (uint8_t *)(T + cols_padded_word + start_word), len_ymm);
     T += cols_padded_word;
   }
 }
@@ -212,53 +296,217 @@ word_t matrix_read_bits(matrix_t M, size_t x, size_t y, size_t n) {
   return temp >> (WORD_SIZE - n);
 }
 
+/* XOR 'len' AVX registers of 'nb' rows into 'x', four rows at a time. */
+static void xor_rows_avx(uint8_t *x, uint8_t **y, size_t nb, size_t len) {
+  for (; nb >= 4; nb -= 4, y += 4) xor_avx4(x, y[0], y[1], y[2], y[3], x, len);
+  if (nb == 3)
+    xor_avx3(x, y[0], y[1], y[2], x, len);
+  else if (nb == 2)
+    xor_avx2(x, y[0], y[1], x, len);
+  else if (nb == 1)
+    xor_avx1(x, y[0], x, len);
+}
+
+/* Reduce rows 'rstart' to 'rstop - 1' using 'nb_tables' tables built from
+ * consecutive blocks of 'k' columns starting from column 'cstart' (the last
+ * one is only 'klast' columns wide).
+ *
+ * As the pivot rows are reduced on these columns, the indices in all the
+ * tables can be read before updating the row. Only the columns from the AVX
+ * register holding column 'cstart' are updated. */
 void matrix_process_rows(matrix_t M, size_t rstart, size_t cstart, size_t rstop,
-                         size_t k, size_t cols, uint64_t *T, int **rev) {
+                         size_t k, size_t klast, size_t nb_tables, size_t cols,
+                         uint64_t *T, int **rev) {
   size_t cols_padded = AVX_PADDING(cols);
-  size_t cols_padded_ymm = cols_padded / 256;
   size_t cols_padded_word = cols_padded / 64;
+  size_t table_word = (1UL << k) * cols_padded_word;
+  size_t start_word = cstart / 256 * 4;
+  size_t len_ymm = (cols_padded_word - start_word) / 4;
+  uint8_t *y[MAX_TABLES];
+
+  /* Without the list of rows to XOR, which costs more than it saves here. */
+  if (nb_tables == 1) {
+    for (size_t r = rstart; r < rstop; ++r) {
+      size_t x = rev[klast][matrix_read_bits(M, r, cstart, klast)];
+      if (x)
+        xor_avx1((uint8_t *)(T + x * cols_padded_word + start_word),
+                 (uint8_t *)(M[r] + start_word), (uint8_t *)(M[r] + start_word),
+                 len_ymm);
+    }
+    return;
+  }
 
   for (size_t r = rstart; r < rstop; ++r) {
-    size_t x0 = rev[k][matrix_read_bits(M, r, cstart, k)];
-    if (x0)
-      xor_avx1((uint8_t *)(T + x0 * cols_padded_word), (uint8_t *)M[r],
-               (uint8_t *)M[r], cols_padded_ymm);
+    size_t nb = 0;
+    for (size_t t = 0; t < nb_tables; ++t) {
+      size_t kt = (t + 1 == nb_tables) ? klast : k;
+      size_t x = rev[kt][matrix_read_bits(M, r, cstart + t * k, kt)];
+      if (x)
+        y[nb++] =
+            (uint8_t *)(T + t * table_word + x * cols_padded_word + start_word);
+    }
+    xor_rows_avx((uint8_t *)(M[r] + start_word), y, nb, len_ymm);
   }
 }
 
+void matrix_team_init(struct matrix_team *team, size_t size) {
+  team->size = size;
+  atomic_init(&team->count, 0);
+  atomic_init(&team->phase, 0);
+  team->kbar = 0;
+}
+
+/* Wait for all the threads of the team. Spin for a while before yielding, in
+ * case there are more threads than cores. */
+void matrix_team_barrier(struct matrix_team *team) {
+  size_t phase = atomic_load(&team->phase);
+  if (atomic_fetch_add(&team->count, 1) + 1 == team->size) {
+    atomic_store(&team->count, 0);
+    atomic_store(&team->phase, phase + 1);
+    return;
+  }
+  for (size_t spin = 0; atomic_load(&team->phase) == phase; ++spin) {
+    if (spin < 4096)
+      _mm_pause();
+    else
+      sched_yield();
+  }
+}
+
+/*
+ * Method of the Four Russians with several tables.
+ *
+ * Each step echelonizes a block of up to 'nb_tables' * k columns and builds
+ * one Gray code table per k columns so that every other row is reduced on the
+ * whole block in a single pass.
+ */
 size_t matrix_echelonize_partial(matrix_t M, size_t rows, size_t cols, size_t k,
-                                 size_t rstop, uint64_t *xor_rows, int **rev,
-                                 int **diff) {
-  size_t kk = k;
+                                 size_t nb_tables, size_t rstop,
+                                 uint64_t *xor_rows, int **rev, int **diff) {
+  struct matrix_team team;
+  matrix_team_init(&team, 1);
+  return matrix_echelonize_partial_team(M, rows, cols, k, nb_tables, rstop,
+                                        xor_rows, rev, diff, &team, 0);
+}
+
+/*
+ * Same as 'matrix_echelonize_partial', called by each of the 'team->size'
+ * threads of a team with its index 'id'.
+ *
+ * The first thread echelonizes each block of columns, the tables are
+ * distributed among the threads and the other rows are split in contiguous
+ * ranges.
+ */
+size_t matrix_echelonize_partial_team(matrix_t M, size_t rows, size_t cols,
+                                      size_t k, size_t nb_tables, size_t rstop,
+                                      uint64_t *xor_rows, int **rev, int **diff,
+                                      struct matrix_team *team, size_t id) {
+  size_t cols_padded_word = AVX_PADDING(cols) / 64;
+  size_t table_word = (1UL << k) * cols_padded_word;
 
   size_t r = 0;
   size_t c = 0;
 
   while (c < rstop) {
+    size_t kk = nb_tables * k;
     if (c + kk > rstop) {
       kk = rstop - c;
     }
-    size_t kbar;
-    kbar = matrix_gauss_submatrix(M, r, c, rows, cols, kk);
+    if (id == 0) team->kbar = matrix_gauss_submatrix(M, r, c, rows, cols, kk);
+    matrix_team_barrier(team);
+    size_t kbar = team->kbar;
     if (kk != kbar) break;
 
     if (kbar > 0) {
-      matrix_make_table(M, r, cols, kbar, xor_rows, diff);
-      matrix_process_rows(M, r + kbar, c, rows, kbar, cols, xor_rows, rev);
-      matrix_process_rows(M, 0, c, r, kbar, cols, xor_rows, rev);
+      size_t nb = (kbar + k - 1) / k;
+      size_t klast = kbar - (nb - 1) * k;
+      for (size_t t = id; t < nb; t += team->size) {
+        size_t kt = (t + 1 == nb) ? klast : k;
+        matrix_make_table(M, r + t * k, c, cols, kt, xor_rows + t * table_word,
+                          diff);
+      }
+      matrix_team_barrier(team);
+
+      /* Rows below the pivots are numbered first, then the rows above. */
+      size_t nb_rows = rows - kbar;
+      size_t start = id * nb_rows / team->size;
+      size_t stop = (id + 1) * nb_rows / team->size;
+      size_t below = rows - r - kbar;
+      if (start < below)
+        matrix_process_rows(M, r + kbar + start, c,
+                            r + kbar + (stop < below ? stop : below), k, klast,
+                            nb, cols, xor_rows, rev);
+      if (stop > below)
+        matrix_process_rows(M, (start > below ? start : below) - below, c,
+                            stop - below, k, klast, nb, cols, xor_rows, rev);
+      matrix_team_barrier(team);
     }
 
     r += kbar;
     c += kbar;
   }
 
+  /* Nobody reads 'team->kbar' again before the first thread writes it. */
+  matrix_team_barrier(team);
   return r;
 }
 
-size_t matrix_opt_k(size_t a, size_t b) {
-  size_t n = (a < b) ? a : b;
-  size_t res = (int)(0.75 * (1 + flb(n)));
-  res = (1 > res) ? 1 : res;
-  res = (MAX_K < res) ? MAX_K : res;
+/* Size of the L2 cache in bytes. */
+static size_t cache_size_l2(void) {
+  long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  if (size > 0) return size;
+
+  /* Fall back on sysfs when the C library does not know. */
+  FILE *f = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+  if (f) {
+    char unit = 0;
+    if (fscanf(f, "%ld%c", &size, &unit) < 1) size = 0;
+    fclose(f);
+    if (unit == 'K') size <<= 10;
+    if (unit == 'M') size <<= 20;
+    if (size > 0) return size;
+  }
+
+  return 256 << 10;
+}
+
+/*
+ * Choose the number of tables for a matrix with 'a' rows and 'b' columns.
+ *
+ * More tables mean fewer passes over the rows, which matters most once the
+ * matrix no longer stays in the L2 cache between two passes. While it does,
+ * the larger blocks of columns to echelonize and the extra tables to build
+ * cost more than they save, and a single table is used.
+ */
+size_t matrix_opt_tables(size_t a, size_t b) {
+  if (a * AVX_PADDING(b) / 8 <= cache_size_l2() / 2) return 1;
+  return MAX_TABLES;
+}
+
+/*
+ * Choose k for a matrix with 'a' rows and 'b' columns.
+ *
+ * With a single table, k grows as 3/4 of the logarithm of the smaller
+ * dimension. With several ones, reducing the rows on k columns costs one
+ * table of 2^k rows and one XOR per row, so k minimizes (2^k + a) / k. The
+ * tables should also fit in half of the L2 cache, the other half being left
+ * to the rows streamed through it.
+ */
+size_t matrix_opt_k(size_t a, size_t b, size_t nb_tables) {
+  if (nb_tables == 1) {
+    size_t n = (a < b) ? a : b;
+    size_t res = (int)(0.75 * (1 + flb(n)));
+    res = (1 > res) ? 1 : res;
+    res = (MAX_K < res) ? MAX_K : res;
+    return res;
+  }
+
+  size_t cache = cache_size_l2() / 2;
+  size_t res = 1;
+  for (size_t k = 2; k <= MAX_K; ++k) {
+    if (matrix_tables_size(k, nb_tables, b) > cache) break;
+    /* (2^k + a) / k < (2^res + a) / res */
+    if (((1UL << k) + a) * res < ((1UL << res) + a) * k) res = k;
+  }
   return res;
 }
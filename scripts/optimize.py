@@ -7,18 +7,24 @@ import sys
 NB_BENCHMARK = 100
 
 
-def proba(N, K, W, L, P, EPS):
+def proba(N, K, W, L, P, EPS, N1=None, P1=None):
     s = mpz(0)
-    for p in range(0, P + 2, 2):
-        P1 = p // 2
-        P2 = p - P1
+    if N1 is None:
         N1 = (K + L) // 2
-        N2 = K + L - N1
+    N2 = K + L - N1
+    if P1 is None:
+        P1 = P // 2
+    # Both lists can cancel the same positions in the overlap, each one losing
+    # the same weight.
+    for j in range(min(P1, P - P1) + 1):
+        p1 = P1 - j
+        p2 = P - P1 - j
+        p = p1 + p2
 
-        for i1 in range(P1 + 1):
-            for i2 in range(P2 + 1):
-                s += bincoef(N1 - EPS, P1 - i1) * bincoef(
-                    N2 - EPS, P2 - i2) * bincoef(2 * EPS, i1 + i2) * bincoef(
+        for i1 in range(p1 + 1):
+            for i2 in range(p2 + 1):
+                s += bincoef(N1 - EPS, p1 - i1) * bincoef(
+                    N2 - EPS, p2 - i2) * bincoef(2 * EPS, i1 + i2) * bincoef(
                         N - K - L, W - p)
     if bincoef(N, W) < 2**(N - K):
         s /= bincoef(N, W)
@@ -28,10 +34,12 @@ def proba(N, K, W, L, P, EPS):
 
 
 # Estimated time in microseconds
-def estimate_time(command, LW, W, P, L, EPS):
+def estimate_time(command, LW, W, N1, P1, P, L, EPS):
+    if P1 is None:
+        P1 = P // 2
     compile_command = """
-    cmake -B build -DDUMER_L={l}L -DDUMER_P={p}L -DDUMER_EPS={eps}L -DDUMER_LW={lw} -DBENCHMARK={nb_benchmark}UL && cmake --build build/ -j
-    """.format(l=L, p=P, eps=EPS, lw=LW, nb_benchmark=NB_BENCHMARK)
+    cmake -B build -DDUMER_L={l}L -DDUMER_P={p}L -DDUMER_P1={p1}L -DDUMER_EPS={eps}L -DDUMER_LW={lw} -DBENCHMARK={nb_benchmark}UL && cmake --build build/ -j
+    """.format(l=L, p=P, p1=P1, eps=EPS, lw=LW, nb_benchmark=NB_BENCHMARK)
     comp = subprocess.Popen(compile_command,
                             shell=True,
                             stdout=subprocess.DEVNULL,
@@ -58,7 +66,7 @@ def estimate_time(command, LW, W, P, L, EPS):
         time = int(last_line)
     except:
         return 0
-    return time / proba(N, K, W, L, P, EPS) / 1e3 / NB_BENCHMARK
+    return time / proba(N, K, W, L, P, EPS, N1, P1) / 1e3 / NB_BENCHMARK
 
 
 if __name__ == '__main__':
@@ -68,10 +76,16 @@ if __name__ == '__main__':
     EPS = 10
     L = 12
     LW = 0
+    N1 = None
+    P1 = None
     for arg in sys.argv[1:]:
-        match = re.fullmatch(r"(W|P|EPS|L)=(\d+)", arg)
+        match = re.fullmatch(r"(W|P|P1|EPS|L|N1)=(\d+)", arg)
         if match and match.group(1) == "W":
             W = int(match.group(2))
+        elif match and match.group(1) == "N1":
+            N1 = int(match.group(2))
+        elif match and match.group(1) == "P1":
+            P1 = int(match.group(2))
         elif match and match.group(1) == "P":
             P = int(match.group(2))
         elif match and match.group(1) == "EPS":
@@ -84,6 +98,11 @@ if __name__ == '__main__':
         if match:
             LW = 1
 
+    if N1 is not None:
+        command.append(str(N1))
+    if P1 is not None and not 1 <= P1 < P:
+        sys.exit("P1 should be between 1 and P - 1.")
+
     print("{:>5} {:>5} {:>5} {}".format("P", "L", "EPS", "Est. time"))
 
     # Hill-climbing optimization
@@ -92,13 +111,13 @@ if __name__ == '__main__':
     while not local_min:
         vs = []
         for dL in [0, -1, 1]:
-            if L + dL > 0 and L + dL <= 64:
+            if L + dL > 0 and L + dL <= 128:
                 for dEPS in [0, -1, 1]:
                     if EPS + dEPS > 0 and EPS + dEPS <= 64:
                         vs.append((P, L + dL, EPS + dEPS))
         for v in vs:
             if v not in times:
-                times[v] = estimate_time(command, LW, W, *v)
+                times[v] = estimate_time(command, LW, W, N1, P1, *v)
                 str_time = str(datetime.timedelta(microseconds=int(times[v])))
                 if times[v] != 0:
                     print("{:5} {:5} {:5} {}".format(*v, str_time))
@@ -108,5 +127,7 @@ if __name__ == '__main__':
             _, vmin = min((times[v], v) for v in vs)
             P, L, EPS = vmin
 
-    print("-DDUMER_P={p}L -DDUMER_L={l}L -DDUMER_EPS={eps}L".format(
-        p=P, l=L, eps=EPS))
+    if P1 is None:
+        P1 = P // 2
+    print("-DDUMER_P={p}L -DDUMER_P1={p1}L -DDUMER_L={l}L -DDUMER_EPS={eps}L".
+          format(p=P, p1=P1, l=L, eps=EPS))
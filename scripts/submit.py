@@ -0,0 +1,33 @@
+import socket
+import sys
+
+
+# Send an instance to an isd daemon and print its reply as it comes
+def submit(address, request, instance):
+    if ":" in address and "/" not in address:
+        host, port = address.rsplit(":", 1)
+        sock = socket.create_connection((host, int(port)))
+    else:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(address)
+    sock.sendall((request + "\n").encode())
+    with open(instance, "rb") as f:
+        sock.sendall(f.read())
+    sock.shutdown(socket.SHUT_WR)
+    status = None
+    with sock.makefile("r") as reply:
+        for line in reply:
+            print(line, end="", flush=True)
+            if line.startswith("status="):
+                status = line.split()[0][len("status="):]
+    sock.close()
+    return status
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 4:
+        print("Usage: {} ADDRESS TYPE FILE [TIMEOUT [N1]]".format(sys.argv[0]))
+        sys.exit(1)
+    request = " ".join([sys.argv[2]] + sys.argv[4:])
+    status = submit(sys.argv[1], request, sys.argv[3])
+    sys.exit(0 if status in ("solved", "stopped") else 1)
@@ -0,0 +1,133 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MEMINFO "/proc/meminfo"
+#define THP_ENABLED "/sys/kernel/mm/transparent_hugepage/enabled"
+#define DEFAULT_HUGE_PAGE_SIZE (2UL << 20)
+
+/* Size of the default huge pages. */
+static size_t huge_page_size(void) {
+  FILE *file = fopen(MEMINFO, "r");
+  if (!file) return DEFAULT_HUGE_PAGE_SIZE;
+  char line[128];
+  size_t kb = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "Hugepagesize: %zu kB", &kb) == 1) break;
+  }
+  fclose(file);
+  return kb ? kb << 10 : DEFAULT_HUGE_PAGE_SIZE;
+}
+
+/* Whether the kernel backs the mappings asking for it with huge pages. */
+static int thp_enabled(void) {
+  FILE *file = fopen(THP_ENABLED, "r");
+  if (!file) return 0;
+  char line[128];
+  int enabled = fgets(line, sizeof(line), file) &&
+                (strstr(line, "[always]") || strstr(line, "[madvise]"));
+  fclose(file);
+  return enabled;
+}
+
+static size_t round_up(size_t size, size_t page) {
+  return (size + page - 1) / page * page;
+}
+
+arena_t alloc_arena(size_t size, int prefault) {
+  arena_t arena = malloc(sizeof(struct arena));
+  if (!arena) return NULL;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t huge = huge_page_size();
+  uint8_t *base = MAP_FAILED;
+  arena->used = 0;
+  arena->hugetlb = 0;
+
+  /* Smaller arenas would only waste most of a huge page. */
+  if (size >= huge) {
+    arena->size = round_up(size, huge);
+    arena->page_size = huge;
+    /* Fails at once if not enough huge pages are reserved. */
+    base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    arena->hugetlb = (base != MAP_FAILED);
+    if (base == MAP_FAILED && thp_enabled()) {
+      /* Transparent huge pages need the mapping aligned on them. */
+      uint8_t *map = mmap(NULL, arena->size + huge, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (map != MAP_FAILED) {
+        base = (uint8_t *)round_up((uintptr_t)map, huge);
+        if (base != map) munmap(map, base - map);
+        munmap(base + arena->size, huge - (base - map));
+        if (madvise(base, arena->size, MADV_HUGEPAGE)) arena->page_size = page;
+      }
+    }
+  }
+  if (base == MAP_FAILED) {
+    arena->size = round_up(size ? size : 1, page);
+    arena->page_size = page;
+    base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      free(arena);
+      return NULL;
+    }
+  }
+  arena->base = base;
+
+  if (prefault) {
+    for (size_t i = 0; i < arena->size; i += page) {
+      ((volatile uint8_t *)base)[i] = 0;
+    }
+  }
+  return arena;
+}
+
+size_t arena_mapped_size(size_t size) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t huge = huge_page_size();
+  if (size >= huge) return round_up(size, huge);
+  return round_up(size ? size : 1, page);
+}
+
+void free_arena(arena_t arena) {
+  munmap(arena->base, arena->size);
+  free(arena);
+}
+
+void *arena_alloc(arena_t arena, size_t size) {
+  size_t offset = round_up(arena->used, ARENA_ALIGN);
+  arena->used = offset + size;
+  if (!arena->base || arena->used > arena->size) return NULL;
+  return arena->base + offset;
+}
+
+int arena_owns(arena_t arena, const void *ptr) {
+  const uint8_t *p = ptr;
+  return p >= arena->base && p < arena->base + arena->size;
+}
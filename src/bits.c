@@ -89,6 +89,17 @@ void xor_bcast_64(uint64_t x, uint8_t *y, uint8_t *z, unsigned n) {
   }
 }
 
+void xor_bcast_128(unsigned __int128 x, uint8_t *y, uint8_t *z, unsigned n) {
+  __m256i vec_x;
+  asm("vbroadcasti128 %[x], %[vec_x]\n\t" : [vec_x] "=x"(vec_x) : [x] "m"(x) :);
+  for (unsigned i = 0; i < n; i += 1) {
+    asm("vpxor   %[vec_yi], %[vec_x], %[vec_z]\n\t"
+        : [vec_z] "=x"(((__m256 *)z)[i])
+        : [vec_x] "%x"(vec_x), [vec_yi] "m"(((__m256 *)y)[i])
+        :);
+  }
+}
+
 void xor_avx1(uint8_t *x, uint8_t *y, uint8_t *z, unsigned n) {
   for (unsigned i = 0; i < n; i += 1) {
     __m256i vec_x;
@@ -171,6 +182,31 @@ void xor_avx4(uint8_t *x, uint8_t *y1, uint8_t *y2, uint8_t *y3, uint8_t *y4,
   }
 }
 
+/*
+ * XOR 'x' with the 'p' vectors of 'y' given by 'pos', each vector of 'y' being
+ * 'stride' AVX registers long.
+ */
+void xor_avx_pos(uint8_t *x, uint8_t *y, const uint16_t *pos, unsigned p,
+                 unsigned stride, uint8_t *z, unsigned n) {
+  for (unsigned i = 0; i < n; i += 1) {
+    __m256i vec_x;
+    asm("vmovdqa   %[x], %[vec_x]\n\t"
+        : [vec_x] "=x"(vec_x)
+        : [x] "m"(((__m256i *)x)[i])
+        :);
+    for (unsigned a = 0; a < p; ++a) {
+      asm("vpxor   %[vec_yi], %[vec_x], %[vec_x]\n\t"
+          : [vec_x] "+x"(vec_x)
+          : [vec_yi] "m"(((__m256i *)y)[pos[a] * stride + i])
+          :);
+    }
+    asm("vmovdqa  %[vec_x], %[z]\n\t"
+        : [z] "=m"(((__m256i *)z)[i])
+        : [vec_x] "x"(vec_x)
+        :);
+  }
+}
+
 void copy_avx(uint8_t *dst, const uint8_t *src, unsigned n) {
   for (unsigned i = 0; i < n; ++i) {
     __m256i vec_src;
@@ -0,0 +1,146 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "codeword_set.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SIZE 64
+
+static uint64_t hash_support(const uint32_t *support, size_t w) {
+  uint64_t hash = 0x9e3779b97f4a7c15UL;
+  for (size_t i = 0; i < w; ++i) {
+    hash ^= support[i];
+    hash *= 0xff51afd7ed558ccdUL;
+    hash ^= hash >> 32;
+  }
+  /* 0 marks empty slots. */
+  return hash ? hash : 1;
+}
+
+static int shard_alloc(struct codeword_set_shard *shard, size_t size,
+                       size_t w) {
+  shard->nb = 0;
+  shard->size = size;
+  shard->hashes = calloc(size, sizeof(uint64_t));
+  shard->supports = malloc(size * w * sizeof(uint32_t));
+  return shard->hashes && shard->supports;
+}
+
+codeword_set_t codeword_set_alloc(size_t w) {
+  codeword_set_t set = malloc(sizeof(struct codeword_set));
+  if (!set) return NULL;
+  set->w = w;
+  int ok = 1;
+  for (size_t i = 0; i < CODEWORD_SET_SHARDS; ++i) {
+    ok &= shard_alloc(&set->shards[i], INITIAL_SIZE, w);
+    omp_init_lock(&set->shards[i].lock);
+  }
+  if (!ok) {
+    codeword_set_free(set);
+    return NULL;
+  }
+  return set;
+}
+
+void codeword_set_free(codeword_set_t set) {
+  for (size_t i = 0; i < CODEWORD_SET_SHARDS; ++i) {
+    omp_destroy_lock(&set->shards[i].lock);
+    free(set->shards[i].hashes);
+    free(set->shards[i].supports);
+  }
+  free(set);
+}
+
+/* Remove all the codewords, keeping the memory of the set. */
+void codeword_set_clear(codeword_set_t set) {
+  for (size_t i = 0; i < CODEWORD_SET_SHARDS; ++i) {
+    set->shards[i].nb = 0;
+    memset(set->shards[i].hashes, 0, set->shards[i].size * sizeof(uint64_t));
+  }
+}
+
+/* Slot holding a support, or empty slot where it should be inserted. */
+static size_t find_slot(const struct codeword_set_shard *shard, size_t w,
+                        uint64_t hash, const uint32_t *support) {
+  size_t mask = shard->size - 1;
+  size_t i = hash & mask;
+  while (shard->hashes[i] &&
+         (shard->hashes[i] != hash ||
+          memcmp(&shard->supports[i * w], support, w * sizeof(uint32_t)))) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/*
+ * Double the size of a shard, keeping it at most half full. Return 0 on
+ * allocation error, leaving the shard as it was.
+ */
+static int shard_grow(struct codeword_set_shard *shard, size_t w) {
+  struct codeword_set_shard old = *shard;
+  if (!shard_alloc(shard, 2 * old.size, w)) {
+    free(shard->hashes);
+    free(shard->supports);
+    *shard = old;
+    return 0;
+  }
+  for (size_t i = 0; i < old.size; ++i) {
+    if (!old.hashes[i]) continue;
+    size_t j = find_slot(shard, w, old.hashes[i], &old.supports[i * w]);
+    shard->hashes[j] = old.hashes[i];
+    memcpy(&shard->supports[j * w], &old.supports[i * w],
+           w * sizeof(uint32_t));
+  }
+  shard->nb = old.nb;
+  free(old.hashes);
+  free(old.supports);
+  return 1;
+}
+
+/*
+ * Insert a support given by 'w' increasing positions (padded with
+ * UINT32_MAX for lower weights). Return 1 if it was not in the set yet, or
+ * -1 if the set could not grow to make room for the next ones.
+ *
+ * Only the shard picked by the hash is locked, so that threads seldom wait
+ * for each other.
+ */
+int codeword_set_insert(codeword_set_t set, const uint32_t *support) {
+  size_t w = set->w;
+  uint64_t hash = hash_support(support, w);
+  struct codeword_set_shard *shard =
+      &set->shards[(hash >> 32) % CODEWORD_SET_SHARDS];
+
+  omp_set_lock(&shard->lock);
+  size_t i = find_slot(shard, w, hash, support);
+  int inserted = !shard->hashes[i];
+  if (inserted) {
+    shard->hashes[i] = hash;
+    memcpy(&shard->supports[i * w], support, w * sizeof(uint32_t));
+    /* Still more than half full, it grows again at the next insertion. */
+    if (2 * ++shard->nb > shard->size && !shard_grow(shard, w))
+      inserted = -1;
+  }
+  omp_unset_lock(&shard->lock);
+  return inserted;
+}
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "bits.h"
 #include "matrix.h"
@@ -32,6 +33,35 @@
 #include "transpose.h"
 #include "xoroshiro128plus.h"
 
+#if DUMER_PROFILE || DUMER_TRACE
+/* Start timing phases from now. */
+#define PROFILE_START(start) uint64_t start = profile_clock()
+#define PROFILE_LAP(isd, start, phase) lap_phase(isd, &(start), phase)
+#else
+#define PROFILE_START(start)
+#define PROFILE_LAP(isd, start, phase) (void)(isd)
+#endif
+#if DUMER_PROFILE
+#define PROFILE_COUNT(isd, counter) (++(isd)->profile.count[counter])
+#else
+#define PROFILE_COUNT(isd, counter)
+#endif
+
+#if DUMER_PROFILE || DUMER_TRACE
+/* The phase which started at '*start' ends now, and the next one starts. */
+static inline void lap_phase(isd_t isd, uint64_t *start,
+                             enum profile_phase phase) {
+  uint64_t now = profile_clock();
+#if DUMER_PROFILE
+  isd->profile.time[phase] += now - *start;
+#endif
+#if DUMER_TRACE
+  trace_event(&isd->trace, phase, *start, now);
+#endif
+  *start = now;
+}
+#endif
+
 /* Binomial coefficient. */
 uint64_t bincoef(size_t n, size_t k) {
   uint64_t res = 1;
@@ -43,94 +73,127 @@ uint64_t bincoef(size_t n, size_t k) {
 }
 
 /*
- * List all combinations of 't' elements of a set of 'n' elements.
+ * Enumerate all combinations of DUMER_P2 elements of a set of 'n' elements.
  *
  * Generate a Chase's sequence: the binary representation of a combination and
  * its successor only differ by two bits that are either consecutive of
  * separated by only one position.
  *
  * See exercise 45 of Knuth's The art of computer programming volume 4A.
+ *
+ * The current combination is 'c[1]' < ... < 'c[DUMER_P2]'.
  */
-static void chase(size_t n, size_t t, uint16_t *combinations, uint16_t *diff) {
-  size_t N = 0;
-  uint16_t diff_pos = 0;
-  uint16_t diff_len = 0;
-  int32_t x;
-  uint16_t *c = malloc((t + 2) * sizeof(uint16_t));
-  uint16_t *z = malloc((t + 2) * sizeof(uint16_t));
-  for (size_t j = 1; j <= t + 1; ++j) {
-    z[j] = 0;
+struct chase {
+  size_t n;
+  uint16_t c[DUMER_P2 + 2];
+  uint16_t z[DUMER_P2 + 2];
+  /* r is the least subscript with c[r] >= r. */
+  size_t r;
+  int done;
+};
+
+#define CHASE_BATCH 64
+
+static void chase_init(struct chase *chase, size_t n) {
+  chase->n = n;
+  /* Index 0 is unused. */
+  for (size_t j = 0; j <= DUMER_P2 + 1; ++j) {
+    chase->z[j] = 0;
   }
-  for (size_t j = 1; j <= t + 1; ++j) {
-    c[j] = n - t - 1 + j;
+  chase->c[0] = 0;
+  for (size_t j = 1; j <= DUMER_P2 + 1; ++j) {
+    chase->c[j] = n - DUMER_P2 - 1 + j;
   }
-  /* r is the least subscript with c[r] >= r. */
-  size_t r = 1;
-  size_t j;
+  chase->r = 1;
+  chase->done = 0;
+}
 
-  while (1) {
-    for (size_t i = 1; i <= t; ++i) {
-      combinations[i - 1 + N * t] = c[i];
+/*
+ * Move to the next combination and give in 'diff' the index of the XORed pair
+ * of columns (as computed by 'xor_pairs') that changes. Return 0 when all the
+ * combinations have been enumerated.
+ */
+static inline int chase_next(struct chase *chase, size_t *diff) {
+  uint16_t *c = chase->c;
+  uint16_t *z = chase->z;
+  size_t diff_pos;
+  size_t diff_len;
+  int32_t x;
+  size_t j = chase->r;
+  if (chase->done) return 0;
+
+novisit:
+  if (z[j]) {
+    x = c[j] + 2;
+    if (x < z[j]) {
+      diff_pos = c[j];
+      diff_len = 2;
+      c[j] = x;
+    } else if (x == z[j] && z[j + 1]) {
+      diff_pos = c[j];
+      diff_len = 2 - (c[j + 1] % 2);
+      c[j] = x - (c[j + 1] % 2);
+    } else {
+      z[j] = 0;
+      ++j;
+      if (j <= DUMER_P2) goto novisit;
+      chase->done = 1;
+      return 0;
     }
-    diff[N] = diff_pos + (diff_len - 1) * (n - 1);
-    ++N;
-    j = r;
-
-  novisit:
-    if (z[j]) {
-      x = c[j] + 2;
-      if (x < z[j]) {
-        diff_pos = c[j];
-        diff_len = 2;
-        c[j] = x;
-      } else if (x == z[j] && z[j + 1]) {
-        diff_pos = c[j];
-        diff_len = 2 - (c[j + 1] % 2);
-        c[j] = x - (c[j + 1] % 2);
-      } else {
-        z[j] = 0;
-        ++j;
-        if (j <= t)
-          goto novisit;
-        else
-          goto exit;
-      }
-      if (c[1] > 0) {
-        r = 1;
-      } else {
-        r = j - 1;
-      }
+    if (c[1] > 0) {
+      chase->r = 1;
     } else {
-      x = c[j] + (c[j] % 2) - 2;
-      if (x >= (int32_t)j) {
-        diff_pos = x;
-        diff_len = 2 - (c[j] % 2);
-        c[j] = x;
-        r = 1;
-      } else if (c[j] == j) {
-        diff_pos = j - 1;
-        diff_len = 1;
-        c[j] = j - 1;
-        z[j] = c[j + 1] - ((c[j + 1] + 1) % 2);
-        r = j;
-      } else if (c[j] < j) {
-        diff_pos = c[j];
-        diff_len = j - c[j];
-        c[j] = j;
-        z[j] = c[j + 1] - ((c[j + 1] + 1) % 2);
-        r = (j > 2) ? j - 1 : 1;
-      } else {
-        diff_pos = x;
-        diff_len = 2 - (c[j] % 2);
-        c[j] = x;
-        r = j;
-      }
+      chase->r = j - 1;
+    }
+  } else {
+    x = c[j] + (c[j] % 2) - 2;
+    if (x >= (int32_t)j) {
+      diff_pos = x;
+      diff_len = 2 - (c[j] % 2);
+      c[j] = x;
+      chase->r = 1;
+    } else if (c[j] == j) {
+      diff_pos = j - 1;
+      diff_len = 1;
+      c[j] = j - 1;
+      z[j] = c[j + 1] - ((c[j + 1] + 1) % 2);
+      chase->r = j;
+    } else if (c[j] < j) {
+      diff_pos = c[j];
+      diff_len = j - c[j];
+      c[j] = j;
+      z[j] = c[j + 1] - ((c[j + 1] + 1) % 2);
+      chase->r = (j > 2) ? j - 1 : 1;
+    } else {
+      diff_pos = x;
+      diff_len = 2 - (c[j] % 2);
+      c[j] = x;
+      chase->r = j;
     }
   }
 
-exit:
-  free(c);
-  free(z);
+  *diff = diff_pos + (diff_len - 1) * (chase->n - 1);
+  return 1;
+}
+
+/*
+ * Fill 'diffs' with the next CHASE_BATCH diffs (less at the end of the
+ * sequence) and return their number.
+ *
+ * Generating them apart from the collision search keeps the branches of
+ * 'chase_next' from stalling it.
+ */
+static size_t chase_next_batch(struct chase *chase, uint16_t *diffs) {
+  size_t nb = 0;
+  size_t diff;
+  while (nb < CHASE_BATCH && chase_next(chase, &diff)) diffs[nb++] = diff;
+  return nb;
+}
+
+/* Skip 'nb' combinations. */
+static void chase_skip(struct chase *chase, size_t nb) {
+  size_t diff;
+  for (size_t i = 0; i < nb; ++i) chase_next(chase, &diff);
 }
 
 /* Apply the same permutation to a matrix and an array. */
@@ -167,26 +230,91 @@ static void shuffle_matrix(matrix_t At, size_t *perm, size_t n, size_t n_stop,
   free(state);
 }
 
-/* Randomly choose an information set and perform a Gaussian elimination. */
+#if (DUMER_ELIM_THREADS) == 1
+/*
+ * Randomly choose an information set and perform a Gaussian elimination. Its
+ * phases are timed for 'isd' (DUMER_PROFILE, DUMER_TRACE).
+ */
 static void choose_is(matrix_t A, matrix_t At, size_t *perm, size_t n, size_t k,
-                      size_t l, size_t k_opt, int **rev, int **diff,
-                      uint64_t *xor_rows, uint64_t *S0, uint64_t *S1) {
+                      size_t l, size_t nb_targets, size_t k_opt,
+                      size_t nb_tables, int **rev, int **diff,
+                      uint64_t *xor_rows, uint64_t *S0, uint64_t *S1,
+                      isd_t isd) {
   /* Pick a permutation and perform Gaussian elimination.  */
   size_t r = 0;
+  PROFILE_START(start);
   while (r < n - k - l) {
     shuffle_matrix(At, perm, n, n - k - l, S0, S1);
+    /* Written back in order by the next transposition, once compacted. */
+    matrix_compact(At - 32, n + k + nb_targets + 64, n - k + 64);
+    PROFILE_LAP(isd, start, PROFILE_SHUFFLE);
 #if DUMER_LW
     matrix_transpose_rev_rows(A, At, n, n - k);
+    PROFILE_LAP(isd, start, PROFILE_TRANSPOSE);
+    r = matrix_echelonize_partial(A, n - k, n, k_opt, nb_tables, n - k - l,
+                                  xor_rows, rev, diff);
 #elif !(DUMER_DOOM)  // && !(DUMER_LW)
-    matrix_transpose_rev_rows(A, At, n + 1, n - k);
+    matrix_transpose_rev_rows(A, At, n + nb_targets, n - k);
+    PROFILE_LAP(isd, start, PROFILE_TRANSPOSE);
+    r = matrix_echelonize_partial(A, n - k, n + nb_targets, k_opt, nb_tables,
+                                  n - k - l, xor_rows, rev, diff);
 #else                // DUMER_DOOM && !(DUMER_LW)
     matrix_transpose_rev_rows(A, At, n + k, n - k);
+    PROFILE_LAP(isd, start, PROFILE_TRANSPOSE);
+    r = matrix_echelonize_partial(A, n - k, n + k, k_opt, nb_tables, n - k - l,
+                                  xor_rows, rev, diff);
 #endif
-
-    r = matrix_echelonize_partial(A, n - k, n, k_opt, n - k - l, xor_rows, rev,
-                                  diff);
+    PROFILE_LAP(isd, start, PROFILE_ECHELONIZE);
   }
 }
+#else  // (DUMER_ELIM_THREADS) > 1
+/*
+ * Same as 'choose_is' for all the threads of a team at once.
+ *
+ * Each thread picks its own permutation, then the Gaussian eliminations of
+ * all the information sets of the team are done one after the other by the
+ * whole team.
+ */
+static void choose_is_team(size_t n, size_t k, size_t l, shr_t shr,
+                           isd_t isd) {
+  team_t team = isd->team;
+#if DUMER_LW
+  size_t cols = n;
+#elif !(DUMER_DOOM)  // && !(DUMER_LW)
+  size_t cols = n + isd->nb_targets;
+#else                // DUMER_DOOM && !(DUMER_LW)
+  size_t cols = n + k;
+#endif
+  int done[DUMER_ELIM_THREADS] = {0};
+  size_t nb_left = DUMER_ELIM_THREADS;
+  PROFILE_START(start);
+  while (nb_left > 0) {
+    if (!done[isd->team_id]) {
+      shuffle_matrix(isd->At, isd->perm, n, n - k - l, &isd->S0, &isd->S1);
+      matrix_compact(isd->At - 32, n + k + isd->nb_targets + 64, n - k + 64);
+      PROFILE_LAP(isd, start, PROFILE_SHUFFLE);
+      matrix_transpose_rev_rows(isd->A, isd->At, cols, n - k);
+      PROFILE_LAP(isd, start, PROFILE_TRANSPOSE);
+    }
+    /* Waiting for the team is counted as elimination. */
+    matrix_team_barrier(&team->elim);
+
+    for (size_t i = 0; i < DUMER_ELIM_THREADS; ++i) {
+      if (done[i]) continue;
+      isd_t owner = team->isd[i];
+      size_t r = matrix_echelonize_partial_team(
+          owner->A, n - k, cols, shr->k_opt, shr->nb_tables, n - k - l,
+          owner->xor_rows, isd->tables->gray_rev, isd->tables->gray_diff,
+          &team->elim, isd->team_id);
+      if (r >= n - k - l) {
+        done[i] = 1;
+        --nb_left;
+      }
+    }
+    PROFILE_LAP(isd, start, PROFILE_ECHELONIZE);
+  }
+}
+#endif
 
 /* Extract columns from *A and keep data 32-byte aligned (fitting AVX
  * registers). */
@@ -203,7 +331,11 @@ static void get_columns_H_prime_avx(matrix_t A, uint64_t *columns, size_t n,
 /* Extract columns from *A and keep data LIST_WIDTH-byte aligned. */
 static void get_columns_H_prime(matrix_t A, LIST_TYPE *columns, size_t n) {
   for (size_t j = 0; j < n; ++j) {
+#if LIST_WIDTH == 128
+    columns[j] = ((LIST_TYPE *)A[j])[0] & DUMER_L_MASK;
+#else
     columns[j] = A[j][0] & DUMER_L_MASK;
+#endif
   }
 }
 
@@ -228,6 +360,7 @@ static size_t bin_search(const LIST_TYPE *list, size_t len_list,
   return (*low == value) ? low - list : low - list + 1;
 }
 
+#if (DUMER_P1) >= 2 && (DUMER_P1) <= 4 && !(DUMER_GENERIC)
 /*
  * Build a list containing the XORs of all possible combinations of 'p'
  * columns.
@@ -242,10 +375,6 @@ static void build_list(unsigned n, isd_t isd, const LIST_TYPE *columns,
 #if DUMER_P1 > 3
   LIST_TYPE *scratch2 =
       (LIST_TYPE *)((uint8_t *)scratch1 + AVX_PADDING(n * LIST_WIDTH) / 8);
-#if DUMER_P1 > 4
-  LIST_TYPE *scratch3 =
-      (LIST_TYPE *)((uint8_t *)scratch2 + AVX_PADDING(n * LIST_WIDTH) / 8);
-#endif
 #endif
 #endif
 #endif
@@ -284,14 +413,8 @@ static void build_list(unsigned n, isd_t isd, const LIST_TYPE *columns,
                   AVX_PADDING(i2 * LIST_WIDTH) / 256);
 
         LIST_TYPE *prev_scratch = scratch2;
-#if DUMER_P1 == 4
         for (size_t i3 = 0; i3 < i2; ++i3) {
-#else /* DUMER_P1 > 4 */
-        for (size_t i3 = i2; i3-- > DUMER_P1 - 4;) {
-#endif
           LIST_TYPE val = prev_scratch[i3];
-          xor_bcast(val, (uint8_t *)columns, (uint8_t *)scratch3,
-                    AVX_PADDING(i3 * LIST_WIDTH) / 256);
 #endif
 #endif
 #endif
@@ -309,58 +432,110 @@ static void build_list(unsigned n, isd_t isd, const LIST_TYPE *columns,
 #endif
 #endif
 }
+#else  // (DUMER_P1) < 2 || (DUMER_P1) > 4 || DUMER_GENERIC
+/*
+ * Enumerate the combinations of 'p' - 't' columns among the first 'm' ones,
+ * XORed with the partial sums in 'scratch[t]'.
+ *
+ * The loops are nested the same way as in the specialized version: all of them
+ * iterate backward but the innermost one.
+ */
+static LIST_TYPE *build_list_level(size_t t, size_t m, LIST_TYPE **scratch,
+                                   const LIST_TYPE *columns, LIST_TYPE *list) {
+  const LIST_TYPE *prev_scratch = scratch[t];
+  if (t == DUMER_P1 - 1) {
+    memcpy(list, prev_scratch, m * sizeof(LIST_TYPE));
+    return list + m;
+  }
+  for (size_t i = m; i-- > DUMER_P1 - 1 - t;) {
+    xor_bcast(prev_scratch[i], (uint8_t *)columns, (uint8_t *)scratch[t + 1],
+              AVX_PADDING(i * LIST_WIDTH) / 256);
+    list = build_list_level(t + 1, i, scratch, columns, list);
+  }
+  return list;
+}
+
+/*
+ * Build a list containing the XORs of all possible combinations of 'p'
+ * columns, for any 'p'.
+ */
+static void build_list(unsigned n, isd_t isd, const LIST_TYPE *columns,
+                       LIST_TYPE *list) {
+  LIST_TYPE *scratch[DUMER_P1];
+  scratch[0] = (LIST_TYPE *)columns;
+  for (size_t t = 1; t < DUMER_P1; ++t) {
+    scratch[t] = (LIST_TYPE *)(isd->scratch +
+                               (t - 1) * (AVX_PADDING(n * LIST_WIDTH) / 8));
+  }
+  build_list_level(0, n, scratch, columns, list);
+}
+#endif
+
+/*
+ * Binomial coefficients C(v, t) for v <= n and 1 <= t <= DUMER_P1, used to
+ * unrank the combinations of list1.
+ *
+ * The largest element of a combination is first guessed from the most
+ * significant bits of its rank.
+ */
+static void build_unrank1(size_t n, struct tables *tables) {
+  for (size_t t = 1; t <= DUMER_P1; ++t) {
+    for (size_t v = 0; v <= n; ++v) {
+      tables->binomials1[(t - 1) * (n + 1) + v] = bincoef(v, t);
+    }
+  }
+
+  const uint64_t *binomials = &tables->binomials1[(DUMER_P1 - 1) * (n + 1)];
+  tables->unrank1_shift = 0;
+  while ((binomials[n] >> tables->unrank1_shift) > (1UL << UNRANK1_BITS))
+    ++tables->unrank1_shift;
+  size_t v = DUMER_P1 - 1;
+  for (size_t i = 0; i <= (1UL << UNRANK1_BITS); ++i) {
+    while (v + 1 < n && binomials[v + 1] <= (i << tables->unrank1_shift)) ++v;
+    tables->unrank1_guess[i] = v;
+  }
+}
 
 /*
- * Build the list of the 'p' positions corresponding to the list built by the
- * preceding function.
+ * Give the 'p' positions (in increasing order) of the element of index 'idx'
+ * in the list built by 'build_list'.
  *
- * This list never changes so it is computed only once.
+ * All loops but the innermost one of 'build_list' iterate backward, so
+ * reversing the index gives the rank of the combination in the combinatorial
+ * number system: 'rank' = C(i0, p) + C(i1, p - 1) + ... with i0 > i1 > ...
  */
-static void build_list_pos(size_t n, uint16_t *pos) {
-  /*
-   * Backward iterating is better when we need to XOR because it avoids
-   * computing an offset. But forward iterating is better when just copying
-   * arrays.
-   */
+static inline void unrank1(size_t n, const struct tables *tables, uint64_t idx,
+                           uint16_t *pos) {
 #if DUMER_P1 == 1
-  for (size_t i0 = 0; i0 < n; ++i0) {
-#else /* DUMER_P1 > 1 */
-    for (size_t i0 = n; i0-- > DUMER_P1 - 1;) {
-#endif
-#if DUMER_P1 >= 2
-#if DUMER_P1 == 2
-    for (size_t i1 = 0; i1 < i0; ++i1) {
-#else /* DUMER_P1 > 2 */
-      for (size_t i1 = i0; i1-- > DUMER_P1 - 2;) {
-#endif
-#if DUMER_P1 >= 3
-#if DUMER_P1 == 3
-      for (size_t i2 = 0; i2 < i1; ++i2) {
-#else /* DUMER_P1 > 3 */
-        for (size_t i2 = i1; i2-- > DUMER_P1 - 3;) {
-#endif
-#if DUMER_P1 >= 4
-#if DUMER_P1 == 4
-        for (size_t i3 = 0; i3 < i2; ++i3) {
-#else /* DUMER_P1 > 4 */
-          for (size_t i3 = i2; i3-- > DUMER_P1 - 4;) {
-#endif
-          *(pos++) = i3;
-#endif
-          *(pos++) = i2;
-#endif
-          *(pos++) = i1;
-#endif
-          *(pos++) = i0;
-        }
-#if DUMER_P1 >= 2
-      }
-#if DUMER_P1 >= 3
+  /* The only loop iterates forward. */
+  (void)(n);
+  (void)(tables);
+  pos[0] = idx;
+#else
+  const uint64_t *binomials = &tables->binomials1[(DUMER_P1 - 1) * (n + 1)];
+  uint64_t rank = binomials[n] - 1 - idx;
+  /* Largest v with C(v, p) <= rank, starting from a lower bound. */
+  size_t m = tables->unrank1_guess[rank >> tables->unrank1_shift];
+  while (binomials[m + 1] <= rank) ++m;
+  rank -= binomials[m];
+  pos[DUMER_P1 - 1] = m;
+
+  for (size_t t = DUMER_P1 - 1; t > 1; --t) {
+    binomials = &tables->binomials1[(t - 1) * (n + 1)];
+    /* Largest v < m with C(v, t) <= rank. */
+    size_t low = t - 1;
+    size_t len = m - low;
+    while (len > 1) {
+      size_t half = len / 2;
+      if (binomials[low + half] <= rank) low += half;
+      len -= half;
     }
-#if DUMER_P1 >= 4
+    rank -= binomials[low];
+    pos[t - 1] = low;
+    m = low;
   }
-#endif
-#endif
+  /* The innermost loop iterates forward. */
+  pos[0] = m - 1 - rank;
 #endif
 }
 
@@ -382,7 +557,7 @@ static void build_lut(LIST_TYPE *list, size_t len_list, size_t *lut) {
       lut[idx] =
           lut[idx - offset] + bin_search(list + lut[idx - offset],
                                          lut[idx + offset] - lut[idx - offset],
-                                         idx << DUMER_LUT_SHIFT);
+                                         (LIST_TYPE)idx << DUMER_LUT_SHIFT);
       idx += step;
     }
 
@@ -392,22 +567,28 @@ static void build_lut(LIST_TYPE *list, size_t len_list, size_t *lut) {
   }
 }
 
-static void build_solution(size_t n, size_t r, size_t n1, shr_t shr, isd_t isd,
-                           size_t pc, size_t idx1, size_t idx2, size_t shift) {
+static void build_solution(size_t n, size_t r, size_t n1, isd_t isd, size_t pc,
+                           const uint16_t *pos1, const uint16_t *pos2,
+                           size_t shift) {
+#if DUMER_PIPELINE
+  const size_t *perm = isd->perm_is;
+#else
+  const size_t *perm = isd->perm;
+#endif
   size_t left = r - DUMER_L;
   for (size_t i = 0; i < n; ++i) {
     isd->solution[i] = 0;
   }
   for (size_t a = 0; a < DUMER_P1; ++a) {
-    size_t column = shr->list1_pos[a + idx1 * DUMER_P1];
-    size_t column_permuted = isd->perm[left + column];
+    size_t column = pos1[a];
+    size_t column_permuted = perm[left + column];
     size_t column_shifted =
         column_permuted / r * r + (column_permuted + r - shift) % r;
     isd->solution[column_shifted] ^= 1;
   }
   for (size_t a = 0; a < DUMER_P2; ++a) {
-    size_t column = shr->combinations2[a + idx2 * DUMER_P2] + n1 - DUMER_EPS;
-    size_t column_permuted = isd->perm[left + column];
+    size_t column = pos2[a] + n1 - DUMER_EPS;
+    size_t column_permuted = perm[left + column];
     size_t column_shifted =
         column_permuted / r * r + (column_permuted + r - shift) % r;
     isd->solution[column_shifted] ^= 1;
@@ -416,7 +597,7 @@ static void build_solution(size_t n, size_t r, size_t n1, shr_t shr, isd_t isd,
   size_t pos_bit = 0;
   for (size_t column = 0; column < r; ++column) {
     if ((isd->test_syndrome[pos_byte] >> pos_bit) & 1) {
-      size_t column_permuted = isd->perm[r - 1 - column];
+      size_t column_permuted = perm[r - 1 - column];
       size_t column_shifted =
           column_permuted / r * r + (column_permuted + r - shift) % r;
       isd->solution[column_shifted] ^= 1;
@@ -430,16 +611,47 @@ static void build_solution(size_t n, size_t r, size_t n1, shr_t shr, isd_t isd,
   isd->w_solution = pc;
 }
 
-void print_solution(size_t n, isd_t isd) {
-#if DUMER_LW
-  printf("%ld: ", isd->w_solution);
+/* Hand a solution to the callback, one thread at a time. */
+void report_solution(shr_t shr, isd_t isd) {
+  if (!isd->callback) return;
+#if DUMER_MULTI || DUMER_BATCH
+  size_t target = isd->target;
+#else
+  size_t target = 0;
 #endif
+  int stop;
+#pragma omp critical(report_solution)
+  stop = isd->callback(isd->callback_arg, target, isd->w_solution,
+                       isd->solution);
+  if (stop) atomic_store_explicit(&shr->stop, 1, memory_order_relaxed);
+}
+
+#if DUMER_LW_STREAM
+/*
+ * Report the codeword of 'isd->solution', unless it was already found.
+ * Return 1 if it is new. If it cannot be recorded, all the threads stop on
+ * an error.
+ */
+static int stream_solution(size_t n, shr_t shr, isd_t isd) {
+  uint32_t support[DUMER_LW_STREAM];
+  size_t w = 0;
   for (size_t i = 0; i < n; ++i) {
-    printf("%d", isd->solution[i]);
+    if (isd->solution[i]) support[w++] = i;
+  }
+  for (size_t i = w; i < DUMER_LW_STREAM; ++i) {
+    support[i] = UINT32_MAX;
+  }
+  int inserted = codeword_set_insert(shr->codewords, support);
+  if (inserted < 0) {
+    atomic_store_explicit(&shr->error, 1, memory_order_relaxed);
+    atomic_store_explicit(&shr->stop, 1, memory_order_relaxed);
   }
-  printf("\n");
-  fflush(stdout);
+  if (inserted <= 0) return 0;
+
+  report_solution(shr, isd);
+  return 1;
 }
+#endif
 
 static void xor_pairs(size_t r, size_t n2, isd_t isd) {
   size_t r_padded_bits = AVX_PADDING(r);
@@ -462,84 +674,131 @@ static void xor_pairs(size_t r, size_t n2, isd_t isd) {
   }
 }
 
-static int find_collisions(size_t n, size_t r, size_t n1, shr_t shr,
-                           isd_t isd) {
+static int find_collisions(size_t n, size_t r, size_t n1, size_t n2,
+                           shr_t shr, isd_t isd) {
   int ret = 0;
 
+  /*
+   * Enumerate Chase's sequence.
+   *
+   * With this sequence, computing all the combinations of P2 elements among n2
+   * elements only requires one XOR per new combination by using (2 * N2 - 3)
+   * precomputed XORed pairs of columns.
+   */
+  struct chase chase;
+  chase_init(&chase, n2 + DUMER_EPS);
+  /* Sequence at the start of the current batch of diffs. */
+  struct chase chase_batch = chase;
+  uint16_t diffs[CHASE_BATCH];
+  size_t nb_diffs = 0;
+  size_t i_diff = 0;
+
   size_t r_padded_bits = AVX_PADDING(r);
   size_t r_padded_qword = r_padded_bits / 64;
   size_t r_padded_ymm = r_padded_bits / 256;
 
-#if !(DUMER_DOOM) && !(DUMER_LW)
-#if DUMER_P2 == 2
-  uint16_t pos1 = shr->combinations2[0];
-  uint16_t pos2 = shr->combinations2[1];
-  xor_avx2((uint8_t *)isd->s_full,
+#if DUMER_MULTI
+  /* The syndromes were added to list1. */
+  xor_avx_pos((uint8_t *)&isd->columns2_full[chase.c[1] * r_padded_qword],
+              (uint8_t *)isd->columns2_full, chase.c + 2, DUMER_P2 - 1,
+              r_padded_ymm, (uint8_t *)isd->current_syndrome, r_padded_ymm);
+#elif !(DUMER_DOOM) && !(DUMER_LW)
+#if DUMER_BATCH
+  /* Syndrome being decoded. */
+  uint8_t *s_full = (uint8_t *)&isd->s_full[isd->target * r_padded_qword];
+#else
+  uint8_t *s_full = (uint8_t *)isd->s_full;
+#endif
+#if DUMER_P2 == 2 && !(DUMER_GENERIC)
+  uint16_t pos1 = chase.c[1];
+  uint16_t pos2 = chase.c[2];
+  xor_avx2(s_full,
            (uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
            (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
            (uint8_t *)isd->current_syndrome, r_padded_ymm);
-#elif DUMER_P2 == 3
-    uint16_t pos1 = shr->combinations2[0];
-    uint16_t pos2 = shr->combinations2[1];
-    uint16_t pos3 = shr->combinations2[2];
-    xor_avx3((uint8_t *)isd->s_full,
+#elif DUMER_P2 == 3 && !(DUMER_GENERIC)
+    uint16_t pos1 = chase.c[1];
+    uint16_t pos2 = chase.c[2];
+    uint16_t pos3 = chase.c[3];
+    xor_avx3(s_full,
              (uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos3 * r_padded_qword],
              (uint8_t *)isd->current_syndrome, r_padded_ymm);
-#elif DUMER_P2 == 4
-  uint16_t pos1 = shr->combinations2[0];
-  uint16_t pos2 = shr->combinations2[1];
-  uint16_t pos3 = shr->combinations2[2];
-  uint16_t pos4 = shr->combinations2[3];
-  xor_avx4((uint8_t *)isd->s_full,
+#elif DUMER_P2 == 4 && !(DUMER_GENERIC)
+  uint16_t pos1 = chase.c[1];
+  uint16_t pos2 = chase.c[2];
+  uint16_t pos3 = chase.c[3];
+  uint16_t pos4 = chase.c[4];
+  xor_avx4(s_full,
            (uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
            (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
            (uint8_t *)&isd->columns2_full[pos3 * r_padded_qword],
            (uint8_t *)&isd->columns2_full[pos4 * r_padded_qword],
            (uint8_t *)isd->current_syndrome, r_padded_ymm);
+#else
+  xor_avx_pos(s_full, (uint8_t *)isd->columns2_full, chase.c + 1, DUMER_P2,
+              r_padded_ymm, (uint8_t *)isd->current_syndrome, r_padded_ymm);
 #endif
 #else  // DUMER_DOOM == 1 || DUMER_LW == 1
-#if DUMER_P2 == 2
-    uint16_t pos1 = shr->combinations2[0];
-    uint16_t pos2 = shr->combinations2[1];
+#if DUMER_P2 == 2 && !(DUMER_GENERIC)
+    uint16_t pos1 = chase.c[1];
+    uint16_t pos2 = chase.c[2];
     xor_avx1((uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
              (uint8_t *)isd->current_nosyndrome, r_padded_ymm);
-#elif DUMER_P2 == 3
-    uint16_t pos1 = shr->combinations2[0];
-    uint16_t pos2 = shr->combinations2[1];
-    uint16_t pos3 = shr->combinations2[2];
+#elif DUMER_P2 == 3 && !(DUMER_GENERIC)
+    uint16_t pos1 = chase.c[1];
+    uint16_t pos2 = chase.c[2];
+    uint16_t pos3 = chase.c[3];
     xor_avx2((uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos3 * r_padded_qword],
              (uint8_t *)isd->current_nosyndrome, r_padded_ymm);
-#elif DUMER_P2 == 4
-    uint16_t pos1 = shr->combinations2[0];
-    uint16_t pos2 = shr->combinations2[1];
-    uint16_t pos3 = shr->combinations2[2];
-    uint16_t pos4 = shr->combinations2[3];
+#elif DUMER_P2 == 4 && !(DUMER_GENERIC)
+    uint16_t pos1 = chase.c[1];
+    uint16_t pos2 = chase.c[2];
+    uint16_t pos3 = chase.c[3];
+    uint16_t pos4 = chase.c[4];
     xor_avx3((uint8_t *)&isd->columns2_full[pos1 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos2 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos3 * r_padded_qword],
              (uint8_t *)&isd->columns2_full[pos4 * r_padded_qword],
              (uint8_t *)isd->current_nosyndrome, r_padded_ymm);
+#else
+    xor_avx_pos((uint8_t *)&isd->columns2_full[chase.c[1] * r_padded_qword],
+                (uint8_t *)isd->columns2_full, chase.c + 2, DUMER_P2 - 1,
+                r_padded_ymm, (uint8_t *)isd->current_nosyndrome,
+                r_padded_ymm);
 #endif
 #endif
 
-  uint64_t N = 0;
   goto first;
 
-  for (; N < shr->nb_combinations2; ++N) {
+  while (1) {
+    if (i_diff == nb_diffs) {
+      /* Leave as soon as the search is stopped or out of time. */
+      if (atomic_load_explicit(&shr->stop, memory_order_relaxed)) break;
+      if (isd->deadline > 0 && omp_get_wtime() > isd->deadline) {
+        atomic_store_explicit(&shr->stop, 1, memory_order_relaxed);
+        break;
+      }
+      chase_batch = chase;
+      nb_diffs = chase_next_batch(&chase, diffs);
+      i_diff = 0;
+      if (nb_diffs == 0) break;
+    }
+    size_t diff = diffs[i_diff++];
+    PROFILE_COUNT(isd, PROFILE_CHASE_STEPS);
 #if DUMER_DOOM
     xor_avx1(
         (uint8_t *)isd->current_nosyndrome,
-        (uint8_t *)&isd->xor_pairs[shr->combinations2_diff[N] * r_padded_qword],
+        (uint8_t *)&isd->xor_pairs[diff * r_padded_qword],
         (uint8_t *)isd->current_nosyndrome, r_padded_ymm);
 #else
       xor_avx1((uint8_t *)isd->current_syndrome,
                (uint8_t *)&isd
-                   ->xor_pairs[shr->combinations2_diff[N] * r_padded_qword],
+                   ->xor_pairs[diff * r_padded_qword],
                (uint8_t *)isd->current_syndrome, r_padded_ymm);
 #endif
 
@@ -555,6 +814,7 @@ static int find_collisions(size_t n, size_t r, size_t n1, shr_t shr,
 #endif
 
     LIST_TYPE s_low = ((LIST_TYPE *)isd->current_syndrome)[0] & DUMER_L_MASK;
+    PROFILE_COUNT(isd, PROFILE_LUT_PROBES);
 
 #if (DUMER_LUT) > 0
     size_t idx_lut = isd->list1_lut[s_low >> DUMER_LUT_SHIFT];
@@ -565,83 +825,120 @@ static int find_collisions(size_t n, size_t r, size_t n1, shr_t shr,
 #elif (DUMER_LUT_SHIFT) == 0
         size_t idx_list = isd->list1_lut[s_low];
 #else
-    size_t idx_list = bin_search(isd->list1, shr->nb_combinations1, s_low);
+    size_t idx_list = bin_search(isd->list1, shr->len_list1, s_low);
 #endif
 
-    while (idx_list < shr->nb_combinations1 && isd->list1[idx_list] == s_low) {
+    while (idx_list < shr->len_list1 && isd->list1[idx_list] == s_low) {
+      PROFILE_COUNT(isd, PROFILE_L_HITS);
       uint64_t idx_orig = isd->list1_idx[idx_list];
+#if DUMER_MULTI
+      size_t target = idx_orig / shr->nb_combinations1;
+      idx_orig %= shr->nb_combinations1;
+#endif
+      uint16_t pos[DUMER_P1 + 1];
+      unrank1(n1 + DUMER_EPS, isd->tables, idx_orig, pos);
+      pos[DUMER_P1] = 0;
 
-#if DUMER_P1 == 2
-      uint16_t pos1 = shr->list1_pos[idx_orig * DUMER_P1];
-      uint16_t pos2 = shr->list1_pos[1 + idx_orig * DUMER_P1];
+#if DUMER_MULTI
+      xor_avx1((uint8_t *)isd->current_syndrome,
+               (uint8_t *)&isd->s_full[target * r_padded_qword],
+               (uint8_t *)isd->test_syndrome, r_padded_ymm);
+      xor_avx_pos((uint8_t *)isd->test_syndrome,
+                  (uint8_t *)isd->columns1_full, pos, DUMER_P1, r_padded_ymm,
+                  (uint8_t *)isd->test_syndrome, r_padded_ymm);
+#elif DUMER_P1 == 2 && !(DUMER_GENERIC)
+      uint16_t pos1 = pos[0];
+      uint16_t pos2 = pos[1];
       xor_avx2((uint8_t *)isd->current_syndrome,
                (uint8_t *)&isd->columns1_full[pos1 * r_padded_qword],
                (uint8_t *)&isd->columns1_full[pos2 * r_padded_qword],
                (uint8_t *)isd->test_syndrome, r_padded_ymm);
-#elif DUMER_P1 == 3
-          uint16_t pos1 = shr->list1_pos[idx_orig * DUMER_P1];
-          uint16_t pos2 = shr->list1_pos[1 + idx_orig * DUMER_P1];
-          uint16_t pos3 = shr->list1_pos[2 + idx_orig * DUMER_P1];
+#elif DUMER_P1 == 3 && !(DUMER_GENERIC)
+          uint16_t pos1 = pos[0];
+          uint16_t pos2 = pos[1];
+          uint16_t pos3 = pos[2];
           xor_avx3((uint8_t *)isd->current_syndrome,
                    (uint8_t *)&isd->columns1_full[pos1 * r_padded_qword],
                    (uint8_t *)&isd->columns1_full[pos2 * r_padded_qword],
                    (uint8_t *)&isd->columns1_full[pos3 * r_padded_qword],
                    (uint8_t *)isd->test_syndrome, r_padded_ymm);
-#elif DUMER_P1 == 4
-      uint16_t pos1 = shr->list1_pos[idx_orig * DUMER_P1];
-      uint16_t pos2 = shr->list1_pos[1 + idx_orig * DUMER_P1];
-      uint16_t pos3 = shr->list1_pos[2 + idx_orig * DUMER_P1];
-      uint16_t pos4 = shr->list1_pos[3 + idx_orig * DUMER_P1];
+#elif DUMER_P1 == 4 && !(DUMER_GENERIC)
+      uint16_t pos1 = pos[0];
+      uint16_t pos2 = pos[1];
+      uint16_t pos3 = pos[2];
+      uint16_t pos4 = pos[3];
       xor_avx4((uint8_t *)isd->current_syndrome,
                (uint8_t *)&isd->columns1_full[pos1 * r_padded_qword],
                (uint8_t *)&isd->columns1_full[pos2 * r_padded_qword],
                (uint8_t *)&isd->columns1_full[pos3 * r_padded_qword],
                (uint8_t *)&isd->columns1_full[pos4 * r_padded_qword],
                (uint8_t *)isd->test_syndrome, r_padded_ymm);
+#else
+      xor_avx_pos((uint8_t *)isd->current_syndrome,
+                  (uint8_t *)isd->columns1_full, pos, DUMER_P1, r_padded_ymm,
+                  (uint8_t *)isd->test_syndrome, r_padded_ymm);
 #endif
       size_t pc = popcount(isd->test_syndrome, r_padded_qword, isd->w_target);
       /* Fusion error patterns from both lists. */
-      if (pc <= isd->w_target) {
+      struct chase chase_current;
+      const uint16_t *comb2 = chase_current.c + 1;
+      if (pc > isd->w_target) {
+        PROFILE_COUNT(isd, PROFILE_EARLY_ABORTS);
+      } else {
+        PROFILE_COUNT(isd, PROFILE_FULL_CHECKS);
+        /* Recover the combination of list2 being tested. */
+        chase_current = chase_batch;
+        chase_skip(&chase_current, i_diff);
+
         size_t a1 = 0;
         size_t a2 = 0;
-        size_t column1 = shr->list1_pos[idx_orig * DUMER_P1];
-        size_t column2 = shr->combinations2[N * DUMER_P2] + n1 - DUMER_EPS;
+        size_t column1 = pos[0];
+        size_t column2 = comb2[0] + n1 - DUMER_EPS;
         while (a2 < DUMER_P2 && a1 < DUMER_P1) {
           if (column1 < column2) {
             ++pc;
             ++a1;
-            column1 = shr->list1_pos[a1 + idx_orig * DUMER_P1];
+            column1 = pos[a1];
           } else if (column1 > column2) {
             ++pc;
             ++a2;
-            column2 = shr->combinations2[a2 + N * DUMER_P2] + n1 - DUMER_EPS;
+            column2 = comb2[a2] + n1 - DUMER_EPS;
           } else {
             ++a1;
             ++a2;
-            column1 = shr->list1_pos[a1 + idx_orig * DUMER_P1];
-            column2 = shr->combinations2[a2 + N * DUMER_P2] + n1 - DUMER_EPS;
+            column1 = pos[a1];
+            column2 = comb2[a2] + n1 - DUMER_EPS;
           }
         }
         pc += DUMER_P2 + DUMER_P1 - a1 - a2;
       }
 
       if (pc > 0 && pc <= isd->w_target) {
-#if DUMER_LW
-        omp_set_lock(&shr->w_best_lock);
-        if (pc >= shr->w_best) {
-          isd->w_target = shr->w_best - 1;
-          omp_unset_lock(&shr->w_best_lock);
+#if DUMER_LW && !(DUMER_LW_STREAM)
+        size_t w_best =
+            atomic_load_explicit(&shr->w_best, memory_order_relaxed);
+        while (pc < w_best && !atomic_compare_exchange_weak_explicit(
+                                  &shr->w_best, &w_best, pc,
+                                  memory_order_relaxed, memory_order_relaxed))
+          ;
+        if (pc >= w_best) {
+          /* Another thread found a better codeword. */
+          isd->w_target = w_best - 1;
           continue;
-        } else {
-          shr->w_best = pc;
-          omp_unset_lock(&shr->w_best_lock);
-          isd->w_target = pc - 1;
         }
+        isd->w_target = pc - 1;
 #endif
         /* Found it! */
         isd->w_solution = pc;
-        build_solution(n, r, n1, shr, isd, pc, idx_orig, N, shift);
+#if DUMER_MULTI
+        isd->target = target;
+#endif
+        build_solution(n, r, n1, isd, pc, pos, comb2, shift);
+#if DUMER_LW_STREAM
+        ret |= stream_solution(n, shr, isd);
+#else
         ret = 1;
+#endif
 #if !(DUMER_LW) && !(BENCHMARK)
         return ret;
 #endif
@@ -654,262 +951,625 @@ static int find_collisions(size_t n, size_t r, size_t n1, shr_t shr,
   return ret;
 }
 
-shr_t alloc_shr(size_t n1, size_t n2) {
-  shr_t shr = malloc(sizeof(struct shared));
+/* Number of elements of list1: its combinations for each target. */
+static uint64_t list1_length(size_t n1, size_t nb_targets) {
+#if DUMER_MULTI
+  return nb_targets * bincoef(n1 + DUMER_EPS, DUMER_P1);
+#else
+  (void)(nb_targets);
+  return bincoef(n1 + DUMER_EPS, DUMER_P1);
+#endif
+}
 
-  shr->nb_combinations1 = bincoef(n1 + DUMER_EPS, DUMER_P1);
-  shr->nb_combinations2 = bincoef(n2 + DUMER_EPS, DUMER_P2);
+/* Number of Gray code tables and of rows of each one in the elimination. */
+static void elimination_tables(size_t n, size_t k, size_t nb_targets,
+                               size_t *nb_tables, size_t *k_opt) {
+#if DUMER_LW
+  (void)(nb_targets);
+  size_t cols = n;
+#elif !(DUMER_DOOM)  // && !(DUMER_LW)
+  size_t cols = n + nb_targets;
+#else                // DUMER_DOOM && !(DUMER_LW)
+  (void)(nb_targets);
+  size_t cols = n + k;
+#endif
+  *nb_tables = matrix_opt_tables(n - k, cols);
+  *k_opt = matrix_opt_k(n - k, cols, *nb_tables);
+}
+
+/*
+ * Carve the tables out of 'arena', or only count their size if it has no
+ * memory.
+ */
+static struct tables *carve_tables(arena_t arena, size_t n1) {
+  struct tables *tables = arena_alloc(arena, sizeof(struct tables));
+  uint64_t *binomials1 =
+      arena_alloc(arena, DUMER_P1 * (n1 + DUMER_EPS + 1) * sizeof(uint64_t));
+  int **gray_rev = arena_alloc(arena, (MAX_K + 1) * sizeof(int *));
+  int **gray_diff = arena_alloc(arena, (MAX_K + 1) * sizeof(int *));
+  for (size_t k = 0; k <= MAX_K; ++k) {
+    int *rev = arena_alloc(arena, (1 << k) * sizeof(int));
+    int *diff = arena_alloc(arena, (1 << k) * sizeof(int));
+    if (!tables) continue;
+    gray_rev[k] = rev;
+    gray_diff[k] = diff;
+  }
+  if (!tables) return NULL;
+  tables->arena = arena;
+  tables->binomials1 = binomials1;
+  tables->gray_rev = gray_rev;
+  tables->gray_diff = gray_diff;
+  return tables;
+}
 
-  shr->list1_pos = malloc(DUMER_P1 * shr->nb_combinations1 * sizeof(uint16_t));
+struct tables *alloc_tables(size_t n1) {
+  struct arena size = {0};
+  carve_tables(&size, n1);
+  arena_t arena = alloc_arena(size.used, DUMER_PREFAULT);
+  if (!arena) return NULL;
+  return carve_tables(arena, n1);
+}
 
-  shr->combinations2 =
-      malloc(shr->nb_combinations2 * DUMER_P2 * sizeof(uint16_t));
-  shr->combinations2_diff = malloc(shr->nb_combinations2 * sizeof(uint16_t));
+void free_tables(struct tables *tables) { free_arena(tables->arena); }
 
-  if (!shr->list1_pos || !shr->combinations2 || !shr->combinations2_diff)
-    return NULL;
+size_t tables_size(size_t n1) {
+  struct arena size = {0};
+  carve_tables(&size, n1);
+  return arena_mapped_size(size.used);
+}
 
-#if DUMER_LW
-  omp_init_lock(&shr->w_best_lock);
-  shr->w_best = INT_MAX;
+void build_tables(struct tables *tables, size_t n1) {
+  build_unrank1(n1 + DUMER_EPS, tables);
+  matrix_build_gray_code(tables->gray_rev, tables->gray_diff);
+}
+
+shr_t alloc_shr(size_t n1, size_t n2, size_t nb_targets) {
+  shr_t shr = malloc(sizeof(struct shared));
+  if (!shr) return NULL;
+  (void)(n2);
+
+  shr->nb_targets = nb_targets;
+  shr->nb_combinations1 = bincoef(n1 + DUMER_EPS, DUMER_P1);
+  shr->len_list1 = list1_length(n1, nb_targets);
+  shr->len_shared = 0;
+#if DUMER_LW_STREAM
+  shr->codewords = NULL;
+#endif
+#if DUMER_BATCH
+  shr->solved = NULL;
 #endif
 
-  matrix_alloc_gray_code(&shr->gray_rev, &shr->gray_diff);
+  shr->tables = alloc_tables(n1);
+  if (!shr->tables) goto fail;
 
+#if DUMER_LW_STREAM
+  shr->codewords = codeword_set_alloc(DUMER_LW_STREAM);
+  if (!shr->codewords) goto fail;
+  atomic_init(&shr->error, 0);
+#elif DUMER_LW
+  atomic_init(&shr->w_best, INT_MAX);
+#endif
+#if DUMER_BATCH
+  shr->solved = malloc(nb_targets * sizeof(atomic_int));
+  if (!shr->solved) goto fail;
+  for (size_t j = 0; j < nb_targets; ++j) {
+    atomic_init(&shr->solved[j], 0);
+  }
+  atomic_init(&shr->nb_solved, 0);
+#elif !(DUMER_LW)
+  atomic_init(&shr->reported, 0);
+#endif
+  atomic_init(&shr->stop, 0);
   return shr;
+
+fail:
+  free_shr(shr);
+  return NULL;
 }
 
+/* Also frees a structure 'alloc_shr' could only partly allocate. */
 void free_shr(shr_t shr) {
-  free(shr->list1_pos);
-  free(shr->combinations2);
-  free(shr->combinations2_diff);
-#if DUMER_LW
-  omp_destroy_lock(&shr->w_best_lock);
+  if (shr->tables) free_tables(shr->tables);
+#if DUMER_LW_STREAM
+  if (shr->codewords) codeword_set_free(shr->codewords);
 #endif
 
-  matrix_free_gray_code(shr->gray_rev, shr->gray_diff);
-  free(shr);
+  if (shr->len_shared) {
+    munmap(shr, shr->len_shared);
+  } else {
+#if DUMER_BATCH
+    free(shr->solved);
+#endif
+    free(shr);
+  }
 }
 
-void init_shr(shr_t shr, size_t n, size_t k, size_t n1, size_t n2) {
-  /*
-   * Precompute Chase's sequence.
-   *
-   * With this sequence, computing all the combinations of P2 elements among n2
-   * elements only requires one XOR per new combination by using (2 * N2 - 3)
-   * precomputed XORed pairs of columns.
-   */
-  chase(n2 + DUMER_EPS, DUMER_P2, shr->combinations2, shr->combinations2_diff);
-
-  build_list_pos(n1 + DUMER_EPS, shr->list1_pos);
+/* Forget what was found on the previous instance. */
+void reset_shr(shr_t shr) {
+  atomic_store(&shr->stop, 0);
+#if !(DUMER_LW) && !(DUMER_BATCH)
+  atomic_store(&shr->reported, 0);
+#endif
+#if DUMER_LW_STREAM
+  codeword_set_clear(shr->codewords);
+  atomic_store(&shr->error, 0);
+#elif DUMER_LW
+  atomic_store(&shr->w_best, INT_MAX);
+#endif
+#if DUMER_BATCH
+  for (size_t j = 0; j < shr->nb_targets; ++j) {
+    atomic_store(&shr->solved[j], 0);
+  }
+  atomic_store(&shr->nb_solved, 0);
+#endif
+}
 
-  matrix_build_gray_code(shr->gray_rev, shr->gray_diff);
-  shr->k_opt = matrix_opt_k(n - k, n);
+/*
+ * Move the structure (with the flags of the decoded syndromes) to memory
+ * shared with the processes forked afterwards, so that they stop together and
+ * report each solution once. The tables it points to are never written once
+ * computed, so forking shares them as well. Return NULL on failure, leaving
+ * 'shr' untouched.
+ */
+shr_t share_shr(shr_t shr) {
+#if DUMER_LW_STREAM
+  /* The set of codewords output would not be shared. */
+  (void)(shr);
+  return NULL;
+#else
+  size_t len = sizeof(struct shared);
+#if DUMER_BATCH
+  len += shr->nb_targets * sizeof(atomic_int);
+#endif
+  shr_t shared = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) return NULL;
+  memcpy(shared, shr, sizeof(struct shared));
+  shared->len_shared = len;
+#if DUMER_BATCH
+  shared->solved = (atomic_int *)(shared + 1);
+  memcpy(shared->solved, shr->solved, shr->nb_targets * sizeof(atomic_int));
+  free(shr->solved);
+#endif
+  free(shr);
+  return shared;
+#endif
 }
 
-isd_t alloc_isd(size_t n, size_t k, size_t r, size_t n1, size_t n2,
-                uint64_t nb_combinations1, size_t k_opt) {
-  isd_t isd = malloc(sizeof(struct isd));
+void init_shr(shr_t shr, size_t n, size_t k, size_t n1, size_t n2) {
+  (void)(n2);
+  build_tables(shr->tables, n1);
+  elimination_tables(n, k, shr->nb_targets, &shr->nb_tables, &shr->k_opt);
+}
 
-  /* We make sure that the 32 rows before isd->A are allocated so that we do
-   * not have to deal with edge cases during transposition. */
+/*
+ * Carve the buffers of a thread out of 'arena', or only count their size if
+ * it has no memory, adding up the bytes of each part in 'memory'.
+ */
+static void carve_isd(isd_t isd, arena_t arena, struct isd_memory *memory,
+                      size_t n, size_t k, size_t r, size_t n1, size_t n2,
+                      uint64_t len_list1, size_t nb_targets, size_t k_opt,
+                      size_t nb_tables) {
 #if DUMER_LW
-  (void)(k);
-  isd->A = matrix_alloc(r + 64, n);
-  matrix_reset(isd->A, r + 64, n);
+  size_t cols = n;
 #elif !(DUMER_DOOM)  // && !(DUMER_LW)
-  (void)(k);
-  isd->A = matrix_alloc(r + 64, n + 1);
-  matrix_reset(isd->A, r + 64, n + 1);
+  size_t cols = n + nb_targets;
 #else                // DUMER_DOOM && !(DUMER_LW)
-  isd->A = matrix_alloc(r + 64, n + k);
-  matrix_reset(isd->A, r + 64, n + k);
-#endif
-  isd->At = matrix_alloc(n + k + 64, r + 64);
-  matrix_reset(isd->At, n + k + 64, r + 64);
-  if (!isd->A || !isd->At) return NULL;
-  isd->A = isd->A + 32;
-  isd->At = isd->At + 32;
-
-  isd->perm = malloc(n * sizeof(size_t));
-  if (!isd->perm) return NULL;
-
-  isd->size_list1 = LIST_WIDTH * nb_combinations1;
-  isd->list1 = malloc(isd->size_list1 / 8);
-  isd->list1_aux = malloc(isd->size_list1 / 8);
-  isd->list1_idx = malloc(nb_combinations1 * sizeof(size_t));
-  isd->list1_aux2 = malloc(nb_combinations1 * sizeof(size_t));
-  isd->list1_lut = malloc(((1 << DUMER_LUT) + 1) * sizeof(size_t));
-  if (!isd->list1 || !isd->list1_aux || !isd->list1_idx || !isd->list1_aux2 ||
-      !isd->list1_lut)
-    return NULL;
-
+  size_t cols = n + k;
+#endif
+  size_t used = arena->used;
+  /* We make sure that the 32 rows before isd->A are allocated so that we do
+   * not have to deal with edge cases during transposition. The arena is
+   * mapped zeroed, so are the matrices. */
+  void *slab_A = arena_alloc(arena, matrix_slab_size(r + 64, cols));
+  void *slab_At =
+      arena_alloc(arena, matrix_slab_size(n + k + nb_targets + 64, r + 64));
+  if (slab_A && slab_At) {
+    isd->A = matrix_slab(slab_A, r + 64, cols) + 32;
+    isd->At = matrix_slab(slab_At, n + k + nb_targets + 64, r + 64) + 32;
+  }
+  memory->matrices = arena->used - used;
+
+  used = arena->used;
+  isd->size_list1 = LIST_WIDTH * len_list1;
+  isd->list1 = arena_alloc(arena, isd->size_list1 / 8);
+  isd->list1_aux = arena_alloc(arena, isd->size_list1 / 8);
+  isd->list1_idx = arena_alloc(arena, len_list1 * sizeof(size_t));
+  isd->list1_aux2 = arena_alloc(arena, len_list1 * sizeof(size_t));
+  isd->list1_lut =
+      arena_alloc(arena, ((1 << DUMER_LUT) + 1) * sizeof(size_t));
+  isd->scratch = arena_alloc(
+      arena, DUMER_P1 * AVX_PADDING((n1 + DUMER_EPS) * LIST_WIDTH) / 8);
+  memory->list1 = arena->used - used;
+
+  used = arena->used;
   isd->size_columns1_low = AVX_PADDING(LIST_WIDTH * (n1 + DUMER_EPS));
-  isd->columns1_low = aligned_alloc(32, isd->size_columns1_low / 8);
-  if (!isd->size_columns1_low || !isd->columns1_low) return NULL;
+  isd->columns1_low = arena_alloc(arena, isd->size_columns1_low / 8);
 
   isd->size_columns1_full = AVX_PADDING(r) * (n1 + DUMER_EPS);
   isd->size_columns2_full = AVX_PADDING(r) * (n2 + DUMER_EPS);
-  isd->columns1_full = aligned_alloc(32, isd->size_columns1_full / 8);
-  isd->columns2_full = aligned_alloc(32, isd->size_columns2_full / 8);
-  if (!isd->columns1_full || !isd->columns2_full) return NULL;
+  isd->columns1_full = arena_alloc(arena, isd->size_columns1_full / 8);
+  isd->columns2_full = arena_alloc(arena, isd->size_columns2_full / 8);
 
 #if !(DUMER_LW) && !(DUMER_DOOM)
-  isd->s_full = aligned_alloc(32, AVX_PADDING(r) / 8);
-  if (!isd->s_full) return NULL;
+  isd->s_full = arena_alloc(arena, nb_targets * AVX_PADDING(r) / 8);
 #elif !(DUMER_LW) && DUMER_DOOM
-  isd->s_full = aligned_alloc(32, k * AVX_PADDING(r) / 8);
-  if (!isd->s_full) return NULL;
+  isd->s_full = arena_alloc(arena, k * AVX_PADDING(r) / 8);
+#endif
+  memory->columns = arena->used - used;
+
+  used = arena->used;
+  /* Rows of A hold up to n + k (with DOOM) or n + nb_targets columns. */
+  isd->xor_rows = arena_alloc(
+      arena, matrix_tables_size(k_opt, nb_tables, n + k + nb_targets));
+  memory->xor_rows = arena->used - used;
+
+  used = arena->used;
+  isd->perm = arena_alloc(arena, n * sizeof(size_t));
+#if DUMER_PIPELINE
+  isd->perm_is = arena_alloc(arena, n * sizeof(size_t));
 #endif
 
   size_t r_padded_bits = AVX_PADDING(r);
   size_t r_padded_qword = r_padded_bits / 64;
-  isd->test_syndrome = aligned_alloc(32, r_padded_qword * sizeof(uint64_t));
+  isd->test_syndrome = arena_alloc(arena, r_padded_qword * sizeof(uint64_t));
 #if DUMER_DOOM || DUMER_LW
   isd->current_nosyndrome =
-      aligned_alloc(32, r_padded_qword * sizeof(uint64_t));
-  if (!isd->current_nosyndrome) return NULL;
+      arena_alloc(arena, r_padded_qword * sizeof(uint64_t));
 #endif
 #if DUMER_LW
   isd->current_syndrome = isd->current_nosyndrome;
 #else
   isd->current_syndrome =
-      aligned_alloc(32, r_padded_qword * sizeof(uint64_t));
+      arena_alloc(arena, r_padded_qword * sizeof(uint64_t));
 #endif
-  isd->xor_pairs = aligned_alloc(
-      32, (2 * (n2 + DUMER_EPS) - 3) * r_padded_qword * sizeof(uint64_t));
+  isd->xor_pairs = arena_alloc(
+      arena, (2 * (n2 + DUMER_EPS) - 3) * r_padded_qword * sizeof(uint64_t));
 
-  isd->xor_rows =
-      aligned_alloc(32, (1L << k_opt) * AVX_PADDING(n) / 64 * sizeof(uint64_t));
+  isd->solution = arena_alloc(arena, n * sizeof(uint8_t));
+#if DUMER_TRACE
+  isd->trace.events =
+      arena_alloc(arena, DUMER_TRACE * sizeof(struct trace_event));
+#endif
+  memory->other = arena->used - used;
+  memory->total = sizeof(struct isd) + arena_mapped_size(arena->used);
+}
+
+void plan_isd(struct isd_memory *memory, size_t n, size_t k, size_t n1,
+              size_t n2, size_t nb_targets) {
+  size_t nb_tables, k_opt;
+  elimination_tables(n, k, nb_targets, &nb_tables, &k_opt);
+  struct isd isd;
+  struct arena size = {0};
+  carve_isd(&isd, &size, memory, n, k, n - k, n1, n2,
+            list1_length(n1, nb_targets), nb_targets, k_opt, nb_tables);
+}
+
+isd_t alloc_isd(size_t n, size_t k, size_t r, size_t n1, size_t n2,
+                uint64_t len_list1, size_t nb_targets, size_t k_opt,
+                size_t nb_tables) {
+  isd_t isd = malloc(sizeof(struct isd));
+  if (!isd) return NULL;
+  isd->nb_targets = nb_targets;
+  /* The stream goes on from one instance to the next. */
+  if (!seed_random(&isd->S0, &isd->S1)) {
+    free(isd);
+    return NULL;
+  }
+  isd->callback = NULL;
+  isd->callback_arg = NULL;
+  isd->deadline = 0;
+#if DUMER_PROFILE
+  clear_profile(&isd->profile);
+#endif
+#if DUMER_TRACE
+  isd->trace.size = DUMER_TRACE;
+  isd->trace.nb_events = 0;
+#endif
 
-  isd->scratch = aligned_alloc(
-      32, DUMER_P1 * AVX_PADDING((n1 + DUMER_EPS) * LIST_WIDTH) / 8);
-  if (!isd->test_syndrome || !isd->current_syndrome || !isd->xor_pairs ||
-      !isd->xor_rows || !isd->scratch)
+  /* Measured first, the buffers are then carved out of one arena. */
+  struct isd_memory memory;
+  struct arena size = {0};
+  carve_isd(isd, &size, &memory, n, k, r, n1, n2, len_list1, nb_targets,
+            k_opt, nb_tables);
+  isd->arena = alloc_arena(size.used, DUMER_PREFAULT);
+  if (!isd->arena) {
+    free(isd);
     return NULL;
+  }
+  carve_isd(isd, isd->arena, &memory, n, k, r, n1, n2, len_list1, nb_targets,
+            k_opt, nb_tables);
 
   return isd;
 }
 
-void free_isd(isd_t isd, size_t r, size_t n) {
-  matrix_free(isd->A - 32, r);
-  matrix_free(isd->At - 32, n);
-  free(isd->perm);
+void free_isd(isd_t isd) {
+  free_arena(isd->arena);
+  free(isd);
+}
 
-  free(isd->list1);
-  free(isd->list1_aux);
-  free(isd->list1_idx);
-  free(isd->list1_aux2);
-  free(isd->list1_lut);
+#if (DUMER_ELIM_THREADS) > 1
+team_t alloc_teams(size_t nb_teams) {
+  team_t teams = malloc(nb_teams * sizeof(struct team));
+  if (!teams) return NULL;
+  for (size_t i = 0; i < nb_teams; ++i)
+    matrix_team_init(&teams[i].elim, DUMER_ELIM_THREADS);
+  return teams;
+}
 
-  free(isd->columns1_low);
+/* Consecutive threads are put in the same team. */
+void join_team(isd_t isd, team_t teams, size_t thread) {
+  isd->team = &teams[thread / DUMER_ELIM_THREADS];
+  isd->team_id = thread % DUMER_ELIM_THREADS;
+  isd->team->isd[isd->team_id] = isd;
+}
+#endif
 
-  free(isd->columns1_full);
+/*
+ * OR 'nb_lines' packed lines of 'r' bits (see 'parse_buffer'), 'stride'
+ * words apart, into the columns 'col' to 'col + nb_lines - 1' of A. They are
+ * transposed by tiles with 'matrix_transpose', then shifted in place word by
+ * word. Return 0 on allocation error.
+ */
+static int set_columns(matrix_t A, size_t r, size_t col, const uint64_t *lines,
+                       size_t nb_lines, size_t stride) {
+  /* 'matrix_transpose' reads rows up to the next multiple of 32. */
+  size_t nb_read = (nb_lines + 31) / 32 * 32;
+  matrix_t L = malloc(nb_read * sizeof(word_t *));
+  word_t *zero = calloc(stride, sizeof(word_t));
+  matrix_t T = matrix_alloc(r, nb_lines);
+  int ret = L && zero && T;
+  for (size_t i = 0; ret && i < r; ++i) {
+    ret = T[i] != NULL;
+  }
+  if (ret) {
+    for (size_t j = 0; j < nb_read; ++j) {
+      L[j] = (j < nb_lines) ? (word_t *)lines + j * stride : zero;
+    }
+    matrix_transpose(T, L, nb_lines, r);
+
+    size_t shift = col % WORD_SIZE;
+    size_t nb_words = (nb_lines + WORD_SIZE - 1) / WORD_SIZE;
+    for (size_t i = 0; i < r; ++i) {
+      word_t *row = A[i] + col / WORD_SIZE;
+      for (size_t j = 0; j < nb_words; ++j) {
+        row[j] |= T[i][j] << shift;
+        /* Bits past the last column are zero, so is the row past its end. */
+        if (shift && (T[i][j] >> (WORD_SIZE - shift)))
+          row[j + 1] |= T[i][j] >> (WORD_SIZE - shift);
+      }
+    }
+  }
+  if (T) matrix_free(T, r);
+  free(zero);
+  free(L);
+  return ret;
+}
 
-  free(isd->columns2_full);
+/*
+ * Same as 'set_columns' for the 'k' circular shifts of a packed line of 'k'
+ * bits: bit 'i' of column 'col + j' is bit '(i - j) mod k' of the line.
+ */
+static int set_circulant_columns(matrix_t A, size_t k, size_t col,
+                                 const uint64_t *line) {
+  size_t stride = AVX_PADDING(k) / WORD_SIZE;
+  /* The line twice in a row, then a zero word read by the shifts. */
+  size_t len_twice = 2 * k + WORD_SIZE;
+  word_t *twice = calloc((len_twice + WORD_SIZE - 1) / WORD_SIZE,
+                         sizeof(word_t));
+  word_t *lines = calloc(k * stride, sizeof(word_t));
+  int ret = twice && lines;
+  if (ret) {
+    for (size_t i = 0; i < k; ++i) {
+      word_t bit = (line[i / WORD_SIZE] >> (i % WORD_SIZE)) & 1;
+      twice[i / WORD_SIZE] |= bit << (i % WORD_SIZE);
+      twice[(i + k) / WORD_SIZE] |= bit << ((i + k) % WORD_SIZE);
+    }
+    /* Shift 'j' is made of the bits 'k - j' to '2k - j - 1' of 'twice'. */
+    for (size_t j = 0; j < k; ++j) {
+      const word_t *src = twice + (k - j) / WORD_SIZE;
+      size_t shift = (k - j) % WORD_SIZE;
+      word_t *dst = lines + j * stride;
+      for (size_t l = 0; l < (k + WORD_SIZE - 1) / WORD_SIZE; ++l) {
+        dst[l] = src[l] >> shift;
+        if (shift) dst[l] |= src[l + 1] << (WORD_SIZE - shift);
+      }
+      if (k % WORD_SIZE)
+        dst[k / WORD_SIZE] &= ((word_t)1 << (k % WORD_SIZE)) - 1;
+    }
+    ret = set_columns(A, k, col, lines, k, stride);
+  }
+  free(lines);
+  free(twice);
+  return ret;
+}
 
-#if !(DUMER_LW)
-  free(isd->s_full);
+/* Number of columns of A: H, then the syndromes (or shifts of one). */
+static size_t instance_cols(size_t n, size_t k, size_t nb_targets) {
+#if DUMER_LW
+  (void)(k);
+  (void)(nb_targets);
+  return n;
+#elif !(DUMER_DOOM)  // && !(DUMER_LW)
+  (void)(k);
+  return n + nb_targets;
+#else                // DUMER_DOOM && !(DUMER_LW)
+  (void)(nb_targets);
+  return n + k;
 #endif
+}
 
-  free(isd->solution);
-
-  free(isd->scratch);
+size_t instance_size(size_t n, size_t k, size_t nb_targets) {
+  size_t nb_cols = instance_cols(n, k, nb_targets);
+  return sizeof(struct instance) + matrix_slab_size(n - k + 32, nb_cols) +
+         matrix_slab_size(nb_cols, n - k);
+}
 
-  free(isd->test_syndrome);
-#if DUMER_DOOM || DUMER_LW
-  free(isd->current_nosyndrome);
-#endif
-#if !(DUMER_LW)
-  free(isd->current_syndrome);
-#endif
-  free(isd->xor_pairs);
-  free(isd->xor_rows);
+instance_t alloc_instance(size_t n, size_t k, size_t nb_targets) {
+  instance_t inst = malloc(sizeof(struct instance));
+  if (!inst) return NULL;
+  inst->r = n - k;
+  inst->nb_cols = instance_cols(n, k, nb_targets);
+  /* The rows up to the next multiple of 32 are read by the transposition. */
+  inst->A = matrix_alloc_slab(inst->r + 32, inst->nb_cols);
+  inst->At = matrix_alloc_slab(inst->nb_cols, inst->r);
+  if (!inst->A || !inst->At) {
+    free_instance(inst);
+    return NULL;
+  }
+  /* The padding of the rows is copied along with them. */
+  matrix_reset(inst->A, inst->r + 32, inst->nb_cols);
+  matrix_reset(inst->At, inst->nb_cols, AVX_PADDING(inst->r));
+  return inst;
+}
 
-  free(isd);
+void free_instance(instance_t inst) {
+  matrix_free_slab(inst->A, inst->r + 32);
+  matrix_free_slab(inst->At, inst->nb_cols);
+  free(inst);
 }
 
-void init_isd(isd_t isd, enum type current_type, size_t n, size_t k, size_t w,
-              uint8_t *mat_h, uint8_t *mat_s) {
+/*
+ * Build A and At from the packed lines of the instance, over the ones of a
+ * previous instance. Return 0 on allocation error.
+ */
+int build_instance(instance_t inst, enum type current_type, size_t n, size_t k,
+                   const uint64_t *mat_h, const uint64_t *mat_s) {
 #if DUMER_LW
-  (void)w;
+  (void)n;
   (void)mat_s;
 #endif
-  if (!seed_random(&isd->S0, &isd->S1)) exit(EXIT_FAILURE);
-
-  /* Build the M4RI matrix. */
-  for (size_t i = 0; i < n - k; ++i) {
-    isd->A[i][i / WORD_SIZE] |= 1UL << (i % WORD_SIZE);
+  size_t r = inst->r;
+  matrix_reset(inst->A, r, inst->nb_cols);
+  for (size_t i = 0; i < r; ++i) {
+    inst->A[i][i / WORD_SIZE] |= 1UL << (i % WORD_SIZE);
   }
   if (current_type == QC) {
-    for (size_t j = 0; j < k; ++j) {
-      for (size_t i = 0; i < n - k; ++i) {
-        if (mat_h[(i - j + k) % k])
-          isd->A[i][(k + j) / WORD_SIZE] |= 1L << ((k + j) % WORD_SIZE);
-      }
-    }
+    if (!set_circulant_columns(inst->A, k, r, mat_h)) return 0;
   } else if (current_type == SD || current_type == LW || current_type == GO) {
-    for (size_t j = 0; j < k; ++j) {
-      for (size_t i = 0; i < n - k; ++i) {
-        if (mat_h[i + (n - k) * j])
-          isd->A[i][(n - k + j) / WORD_SIZE] |= 1UL
-                                                << ((n - k + j) % WORD_SIZE);
-      }
-    }
+    if (!set_columns(inst->A, r, r, mat_h, k, AVX_PADDING(r) / WORD_SIZE))
+      return 0;
   }
   /* Matrix A is extended with the syndrome(s). */
 #if !(DUMER_LW) && !(DUMER_DOOM)
-  for (size_t i = 0; i < n - k; ++i) {
-    if (mat_s[i]) isd->A[i][n / WORD_SIZE] |= 1L << (n % WORD_SIZE);
-  }
+  if (!set_columns(inst->A, r, n, mat_s, inst->nb_cols - n,
+                   AVX_PADDING(r) / WORD_SIZE))
+    return 0;
 #elif !(DUMER_LW) && DUMER_DOOM
-    /*
-     * In quasi-cyclic codes, a circular permutation of a syndrome is the
-     * syndrome of the blockwise circularly permuted error pattern.
-     */
-    for (size_t j = 0; j < k; ++j) {
-      for (size_t i = 0; i < n - k; ++i) {
-        if (mat_s[(i - j + k) % k])
-          isd->A[i][(n + j) / WORD_SIZE] |= 1L << ((n + j) % WORD_SIZE);
-      }
-    }
+  /*
+   * In quasi-cyclic codes, a circular permutation of a syndrome is the
+   * syndrome of the blockwise circularly permuted error pattern.
+   */
+  if (!set_circulant_columns(inst->A, k, n, mat_s)) return 0;
 #endif
+  matrix_transpose_rev_cols(inst->At, inst->A, r, inst->nb_cols);
+  return 1;
+}
+
+/* Start from the matrix of the instance, with a copy of it of our own. */
+void init_isd(isd_t isd, const instance_t inst, size_t n, size_t w) {
 #if DUMER_LW
-  matrix_transpose_rev_cols(isd->At, isd->A, n - k, n);
-#elif !(DUMER_DOOM)  // && !(DUMER_LW)
-  matrix_transpose_rev_cols(isd->At, isd->A, n - k, n + 1);
-#else                // DUMER_DOOM && !(DUMER_LW)
-  matrix_transpose_rev_cols(isd->At, isd->A, n - k, n + k);
+  (void)w;
 #endif
+  size_t len_row = (inst->nb_cols + WORD_SIZE - 1) / WORD_SIZE;
+  for (size_t i = 0; i < inst->r; ++i) {
+    memcpy(isd->A[i], inst->A[i], len_row * sizeof(word_t));
+  }
+  size_t len_row_t = AVX_PADDING(inst->r) / WORD_SIZE;
+  for (size_t c = 0; c < inst->nb_cols; ++c) {
+    memcpy(isd->At[c], inst->At[c], len_row_t * sizeof(word_t));
+  }
 
   for (size_t i = 0; i < n; ++i) {
     isd->perm[i] = i;
   }
 
-  isd->solution = malloc(n * sizeof(uint8_t));
-#if DUMER_LW
+#if DUMER_LW_STREAM
+  isd->w_target = DUMER_LW_STREAM;
+#elif DUMER_LW
   isd->w_target = n;
 #else
     isd->w_target = w;
 #endif
 }
 
-int dumer(size_t n, size_t k, size_t r, size_t n1, size_t n2, shr_t shr,
-          isd_t isd) {
+/* Choose an information set and extract the columns used by 'search_is'. */
+static void prepare_is(size_t n, size_t k, size_t r, size_t n1, size_t n2,
+                       shr_t shr, isd_t isd) {
   /* Choose a random information set and do a Gaussian elimination. */
-  choose_is(isd->A, isd->At, isd->perm, n, k, DUMER_L, shr->k_opt,
-            shr->gray_rev, shr->gray_diff, isd->xor_rows, &isd->S0, &isd->S1);
+#if (DUMER_ELIM_THREADS) > 1
+  choose_is_team(n, k, DUMER_L, shr, isd);
+#else
+  choose_is(isd->A, isd->At, isd->perm, n, k, DUMER_L, isd->nb_targets,
+            shr->k_opt, shr->nb_tables, isd->tables->gray_rev,
+            isd->tables->gray_diff, isd->xor_rows, &isd->S0, &isd->S1, isd);
+#endif
+  PROFILE_START(start);
 
+  /*
+   * The echelonized matrix is the starting point of the next iteration. Its
+   * first 'r - DUMER_L' columns are unit vectors, only the other ones need to
+   * be transposed.
+   */
 #if DUMER_LW
-  matrix_transpose_rev_cols(isd->At, isd->A, r, n);
+  matrix_transpose_rev_cols_echelon(isd->At, isd->A, r, n, r - DUMER_L);
 #elif !(DUMER_DOOM)  // && !(DUMER_LW)
-  matrix_transpose_rev_cols(isd->At, isd->A, r, n + 1);
+  matrix_transpose_rev_cols_echelon(isd->At, isd->A, r, n + isd->nb_targets,
+                                    r - DUMER_L);
 #else                // DUMER_DOOM && !(DUMER_LW)
-  matrix_transpose_rev_cols(isd->At, isd->A, r, n + k);
+  matrix_transpose_rev_cols_echelon(isd->At, isd->A, r, n + k, r - DUMER_L);
 #endif
+  PROFILE_LAP(isd, start, PROFILE_TRANSPOSE);
 
   get_columns_H_prime(isd->At + r - DUMER_L, isd->columns1_low, n1 + DUMER_EPS);
+  get_columns_H_prime_avx(isd->At + r - DUMER_L, isd->columns1_full,
+                          n1 + DUMER_EPS, r);
+  get_columns_H_prime_avx(isd->At + r - DUMER_L + n1 - DUMER_EPS,
+                          isd->columns2_full, n2 + DUMER_EPS, r);
+
+#if !(DUMER_LW) && !(DUMER_DOOM)
+  get_columns_H_prime_avx(isd->At + n, isd->s_full, isd->nb_targets, r);
+#elif !(DUMER_LW) && DUMER_DOOM
+  get_columns_H_prime_avx(isd->At + n, isd->s_full, r, r);
+#endif
+
+#if DUMER_PIPELINE
+  memcpy(isd->perm_is, isd->perm, n * sizeof(size_t));
+#endif
+  PROFILE_LAP(isd, start, PROFILE_EXTRACT);
+}
+
+#if DUMER_MULTI
+/*
+ * Make one copy of list1 per target, XORed with the DUMER_L least significant
+ * bits of its syndrome, so that a collision with any of the targets is found
+ * with a single search.
+ */
+static void add_targets(size_t r, shr_t shr, isd_t isd) {
+  size_t r_padded_qword = AVX_PADDING(r) / 64;
+  uint64_t len = shr->nb_combinations1;
+  /* The first copy is the original list, it is modified last. */
+  for (size_t j = shr->nb_targets; j-- > 0;) {
+    LIST_TYPE s_low =
+        ((LIST_TYPE *)&isd->s_full[j * r_padded_qword])[0] & DUMER_L_MASK;
+    LIST_TYPE *list = isd->list1 + j * len;
+    for (uint64_t i = 0; i < len; ++i) {
+      list[i] = isd->list1[i] ^ s_low;
+    }
+  }
+}
+#endif
 
+/* Birthday decoding on the columns extracted by 'prepare_is'. */
+static int search_is(size_t n, size_t r, size_t n1, size_t n2, shr_t shr,
+                     isd_t isd) {
+#if DUMER_LW && !(DUMER_LW_STREAM)
+  /* Catch up with the codewords found by the other threads. */
+  size_t w_best = atomic_load_explicit(&shr->w_best, memory_order_relaxed);
+  if (w_best <= isd->w_target) isd->w_target = w_best - 1;
+#endif
+  PROFILE_COUNT(isd, PROFILE_ITERATIONS);
+  PROFILE_START(start);
   /*
    * For the first list, we only keep the LIST_WIDTH least significant bits.
    *
@@ -917,29 +1577,26 @@ int dumer(size_t n, size_t k, size_t r, size_t n1, size_t n2, shr_t shr,
    * LIST_WIDTH least significant bits in list1 and in list2.
    */
   build_list(n1 + DUMER_EPS, isd, isd->columns1_low, isd->list1);
+#if DUMER_MULTI
+  add_targets(r, shr, isd);
+#endif
+  PROFILE_LAP(isd, start, PROFILE_BUILD_LIST);
 
   /* Keep the original index of an element of the list when sorting. */
-  for (uint64_t i = 0; i < shr->nb_combinations1; ++i) {
+  for (uint64_t i = 0; i < shr->len_list1; ++i) {
     isd->list1_idx[i] = i;
   }
   sort(isd->list1, isd->list1_idx, isd->list1_aux, isd->list1_aux2,
-       shr->nb_combinations1);
+       shr->len_list1);
+  PROFILE_LAP(isd, start, PROFILE_SORT);
 #if (DUMER_LUT) > 0
   /* The lookup table speeds up searching in the sorted list. */
-  build_lut(isd->list1, shr->nb_combinations1, isd->list1_lut);
+  build_lut(isd->list1, shr->len_list1, isd->list1_lut);
+  PROFILE_LAP(isd, start, PROFILE_BUILD_LUT);
 #endif
 
-  get_columns_H_prime_avx(isd->At + r - DUMER_L, isd->columns1_full,
-                          n1 + DUMER_EPS, r);
-  get_columns_H_prime_avx(isd->At + r - DUMER_L + n1 - DUMER_EPS,
-                          isd->columns2_full, n2 + DUMER_EPS, r);
-
-#if !(DUMER_LW) && !(DUMER_DOOM)
-  get_columns_H_prime_avx(isd->At + n, isd->s_full, 1, r);
-#elif !(DUMER_LW) && DUMER_DOOM
-  get_columns_H_prime_avx(isd->At + n, isd->s_full, r, r);
-#endif
   xor_pairs(r, n2, isd);
+  PROFILE_LAP(isd, start, PROFILE_XOR_PAIRS);
 
   /*
    * As there is always at least one element matching the LIST_WIDTH least
@@ -949,5 +1606,236 @@ int dumer(size_t n, size_t k, size_t r, size_t n1, size_t n2, shr_t shr,
    * Using Chase's sequence, list2 is computed doing only one XOR per
    * element.
    */
-  return find_collisions(n, r, n1, shr, isd);
+#if DUMER_BATCH
+  /*
+   * Only the syndromes differ between the targets: list1 is shared and list2
+   * is enumerated again for each syndrome not decoded yet.
+   */
+  int ret = 0;
+  for (size_t j = 0; j < shr->nb_targets; ++j) {
+    if (atomic_load_explicit(&shr->solved[j], memory_order_relaxed)) continue;
+    isd->target = j;
+    int found = find_collisions(n, r, n1, n2, shr, isd);
+    PROFILE_LAP(isd, start, PROFILE_FIND_COLLISIONS);
+    if (!found) continue;
+#if !(BENCHMARK)
+    /* A syndrome decoded by several threads is only reported once. */
+    if (atomic_exchange(&shr->solved[j], 1)) continue;
+    report_solution(shr, isd);
+    atomic_fetch_add(&shr->nb_solved, 1);
+#endif
+    ret = 1;
+  }
+  return ret;
+#else
+  int found = find_collisions(n, r, n1, n2, shr, isd);
+  PROFILE_LAP(isd, start, PROFILE_FIND_COLLISIONS);
+  return found;
+#endif
+}
+
+int dumer(size_t n, size_t k, size_t r, size_t n1, size_t n2, shr_t shr,
+          isd_t isd) {
+  prepare_is(n, k, r, n1, n2, shr, isd);
+  return search_is(n, r, n1, n2, shr, isd);
+}
+
+#if DUMER_PIPELINE
+/*
+ * Carve the buffers of a slot out of 'arena', or only count their size if it
+ * has no memory.
+ */
+static void carve_slot(struct slot *slot, arena_t arena, size_t k, size_t r,
+                       size_t n1, size_t n2, size_t nb_targets) {
+#if DUMER_LW || DUMER_DOOM
+  (void)(nb_targets);
+#endif
+  slot->columns1_low =
+      arena_alloc(arena, AVX_PADDING(LIST_WIDTH * (n1 + DUMER_EPS)) / 8);
+  slot->columns1_full =
+      arena_alloc(arena, AVX_PADDING(r) * (n1 + DUMER_EPS) / 8);
+  slot->columns2_full =
+      arena_alloc(arena, AVX_PADDING(r) * (n2 + DUMER_EPS) / 8);
+#if !(DUMER_LW) && !(DUMER_DOOM)
+  slot->s_full = arena_alloc(arena, nb_targets * AVX_PADDING(r) / 8);
+#elif !(DUMER_LW) && DUMER_DOOM
+  slot->s_full = arena_alloc(arena, k * AVX_PADDING(r) / 8);
+#endif
+  slot->perm = arena_alloc(arena, (k + r) * sizeof(size_t));
+}
+
+size_t pipeline_size(size_t nb_threads, size_t k, size_t r, size_t n1,
+                     size_t n2, size_t nb_targets) {
+  struct slot slot;
+  struct arena size = {0};
+  for (size_t i = 0; i < 2 * nb_threads; ++i) {
+    carve_slot(&slot, &size, k, r, n1, n2, nb_targets);
+  }
+  return sizeof(struct pipeline) + arena_mapped_size(size.used) +
+         2 * nb_threads * (sizeof(struct slot) + 2 * sizeof(size_t)) +
+         nb_threads * sizeof(isd_t);
+}
+
+pipeline_t alloc_pipeline(size_t nb_threads, size_t k, size_t r, size_t n1,
+                          size_t n2, size_t nb_targets) {
+  pipeline_t pipe = malloc(sizeof(struct pipeline));
+  if (!pipe) return NULL;
+
+  /* Two slots per thread: one being filled or searched, one waiting. */
+  pipe->nb_slots = 2 * nb_threads;
+  pipe->slots = malloc(pipe->nb_slots * sizeof(struct slot));
+  pipe->free = malloc(pipe->nb_slots * sizeof(size_t));
+  pipe->ready = malloc(pipe->nb_slots * sizeof(size_t));
+  pipe->isd = calloc(nb_threads, sizeof(isd_t));
+  pipe->arena = NULL;
+  if (!pipe->slots || !pipe->free || !pipe->ready || !pipe->isd) goto fail;
+
+  struct arena size = {0};
+  for (size_t i = 0; i < pipe->nb_slots; ++i) {
+    carve_slot(&pipe->slots[i], &size, k, r, n1, n2, nb_targets);
+  }
+  pipe->arena = alloc_arena(size.used, DUMER_PREFAULT);
+  if (!pipe->arena) goto fail;
+  for (size_t i = 0; i < pipe->nb_slots; ++i) {
+    carve_slot(&pipe->slots[i], pipe->arena, k, r, n1, n2, nb_targets);
+    pipe->free[i] = i;
+  }
+  pipe->nb_free = pipe->nb_slots;
+  pipe->ready_head = 0;
+  pipe->nb_ready = 0;
+
+  pipe->nb_threads = nb_threads;
+  pipe->time_prepare = 0;
+  pipe->time_search = 0;
+  pipe->nb_searched = 0;
+  omp_init_lock(&pipe->lock);
+
+  return pipe;
+
+fail:
+  free(pipe->slots);
+  free(pipe->free);
+  free(pipe->ready);
+  free(pipe->isd);
+  free(pipe);
+  return NULL;
+}
+
+/* Exchange the extracted columns of a thread with the ones of a slot. */
+static void swap_slot(isd_t isd, struct slot *slot) {
+  LIST_TYPE *columns1_low = isd->columns1_low;
+  isd->columns1_low = slot->columns1_low;
+  slot->columns1_low = columns1_low;
+
+  uint64_t *columns1_full = isd->columns1_full;
+  isd->columns1_full = slot->columns1_full;
+  slot->columns1_full = columns1_full;
+
+  uint64_t *columns2_full = isd->columns2_full;
+  isd->columns2_full = slot->columns2_full;
+  slot->columns2_full = columns2_full;
+
+#if !(DUMER_LW)
+  uint64_t *s_full = isd->s_full;
+  isd->s_full = slot->s_full;
+  slot->s_full = s_full;
+#endif
+
+  size_t *perm = isd->perm_is;
+  isd->perm_is = slot->perm;
+  slot->perm = perm;
+}
+
+/*
+ * The threads hold buffers of the slots, and the slots buffers of the
+ * threads, after exchanging them: they are exchanged back before the arena of
+ * the slots is unmapped.
+ */
+void free_pipeline(pipeline_t pipe) {
+  size_t i = 0;
+  for (size_t t = 0; t < pipe->nb_threads; ++t) {
+    isd_t isd = pipe->isd[t];
+    if (!isd || !arena_owns(pipe->arena, isd->perm_is)) continue;
+    while (arena_owns(pipe->arena, pipe->slots[i].perm)) ++i;
+    swap_slot(isd, &pipe->slots[i]);
+  }
+  free_arena(pipe->arena);
+  free(pipe->slots);
+  free(pipe->free);
+  free(pipe->ready);
+  free(pipe->isd);
+  omp_destroy_lock(&pipe->lock);
+  free(pipe);
+}
+
+/* Moving average of the duration of a step. */
+static void update_time(double *average, double time) {
+  *average = (*average == 0) ? time : 0.9 * *average + 0.1 * time;
+}
+
+/*
+ * One step of a thread in the pipeline: either prepare an information set
+ * for the ready ring, or run the collision search on one taken from it.
+ *
+ * Threads with a low index prefer preparing, the others prefer searching.
+ * Their numbers follow the measured durations of both steps so that the ring
+ * neither fills up nor runs dry. A thread takes the other role when its
+ * preferred one would have to wait.
+ */
+int dumer_pipeline(size_t n, size_t k, size_t r, size_t n1, size_t n2,
+                   shr_t shr, pipeline_t pipe, isd_t isd, size_t thread) {
+  omp_set_lock(&pipe->lock);
+  size_t nb_prepare = pipe->nb_threads;
+  double total = pipe->time_prepare + pipe->time_search;
+  if (total > 0) {
+    nb_prepare = pipe->nb_threads * pipe->time_prepare / total + 0.5;
+    if (nb_prepare < 1) nb_prepare = 1;
+  }
+  /*
+   * A thread holds at most one slot, so there is always a free slot when none
+   * is ready and conversely.
+   */
+  pipe->isd[thread] = isd;
+  int prepare = pipe->nb_ready == 0 || (thread < nb_prepare && pipe->nb_free);
+  size_t i;
+  if (prepare) {
+    i = pipe->free[--pipe->nb_free];
+  } else {
+    i = pipe->ready[pipe->ready_head];
+    pipe->ready_head = (pipe->ready_head + 1) % pipe->nb_slots;
+    --pipe->nb_ready;
+    swap_slot(isd, &pipe->slots[i]);
+    pipe->free[pipe->nb_free++] = i;
+    ++pipe->nb_searched;
+  }
+  omp_unset_lock(&pipe->lock);
+
+  double start = omp_get_wtime();
+  int found = 0;
+  if (prepare)
+    prepare_is(n, k, r, n1, n2, shr, isd);
+  else
+    found = search_is(n, r, n1, n2, shr, isd);
+  double time = omp_get_wtime() - start;
+
+  omp_set_lock(&pipe->lock);
+  if (prepare) {
+    swap_slot(isd, &pipe->slots[i]);
+    pipe->ready[(pipe->ready_head + pipe->nb_ready) % pipe->nb_slots] = i;
+    ++pipe->nb_ready;
+    update_time(&pipe->time_prepare, time);
+  } else {
+    update_time(&pipe->time_search, time);
+  }
+  omp_unset_lock(&pipe->lock);
+
+  return found;
 }
+
+uint64_t pipeline_nb_searched(pipeline_t pipe) {
+  omp_set_lock(&pipe->lock);
+  uint64_t nb_searched = pipe->nb_searched;
+  omp_unset_lock(&pipe->lock);
+  return nb_searched;
+}
+#endif
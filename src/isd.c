@@ -19,13 +19,28 @@
    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
    IN THE SOFTWARE
 */
+#include <netdb.h>
 #include <omp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "dumer.h"
+#include "libisd.h"
+#include "parse.h"
+#include "xoroshiro128plus.h"
 #ifndef BENCHMARK
 #define BENCHMARK 0
 #endif
@@ -44,280 +59,955 @@ long timer_end(struct timespec start_time) {
   return diff;
 }
 
-static void skip_comment(FILE *file, int *c) {
-  *c = getc(file);
-  if (*c == '#')
-    while ((*c = getc(file)) != EOF && *c != '\n')
-      ;
-  if (*c == '\n') *c = getc(file);
-}
-
-static int read_int(FILE *file, int *c, size_t *n) {
-  if (*c == EOF) return 0;
-  while (*c != EOF && *c != '\n') {
-    if (*c >= '0' && *c <= '9') {
-      *n *= 10;
-      *n += *c - '0';
-    } else
-      return 0;
-    *c = getc(file);
+/* Where the solutions of an instance of length 'n' are printed. */
+struct output {
+  FILE *file;
+  size_t n;
+};
+
+/* Output a solution on one line, after its weight (LW) or its index. */
+static int print_solution(void *arg, size_t target, size_t weight,
+                          const uint8_t *solution) {
+  struct output *out = arg;
+#if DUMER_LW
+  (void)(target);
+  fprintf(out->file, "%ld: ", weight);
+#elif DUMER_MULTI || DUMER_BATCH
+  (void)(weight);
+  fprintf(out->file, "%ld: ", target);
+#else
+  (void)(target);
+  (void)(weight);
+#endif
+  for (size_t i = 0; i < out->n; ++i) {
+    fprintf(out->file, "%d", solution[i]);
   }
-  return 1;
+  fprintf(out->file, "\n");
+  fflush(out->file);
+  /* Nobody is reading the solutions anymore. */
+  return ferror(out->file);
 }
 
-static int read_bin_vector(FILE *file, int *c, uint8_t *m, size_t *len) {
-  if (*c == EOF) return 0;
-  *len = 0;
-  while (*c != EOF && *c != '\n') {
-    if (*c == '1' || *c == '0') {
-      m[(*len)++] = *c - '0';
-    } else
-      return 0;
-    *c = getc(file);
-  }
-  return 1;
+static void print_parameters(size_t n, size_t k, size_t w) {
+  printf("n=%ld ", n);
+  printf("k=%ld ", k);
+  printf("w=%ld\n", w);
+  printf("l=%ld ", DUMER_L);
+  printf("p=%ld ", DUMER_P);
+  printf("epsilon=%ld ", DUMER_EPS);
+  printf("doom=%d\n", DUMER_DOOM);
 }
 
-static int read_bin_matrix(FILE *file, int rows, int *c, uint8_t *m,
-                           size_t *len) {
-  if (*c == EOF) return 0;
-  *len = 0;
-  while (*c != EOF) {
-    if (*c == '1' || *c == '0') {
-      m[(*len)++] = *c - '0';
-    } else if (*c == '\n')
-      --rows;
-    else {
-      return 0;
-    }
-    if (!rows) break;
-    *c = getc(file);
-  }
+static int parse_type(const char *name, enum type *type) {
+  if (!strcmp(name, "QC"))
+    *type = QC;
+  else if (!strcmp(name, "SD"))
+    *type = SD;
+  else if (!strcmp(name, "GO"))
+    *type = GO;
+  else if (!strcmp(name, "LW"))
+    *type = LW;
+  else
+    return 0;
   return 1;
 }
 
-static int parse_input_sd(char *filename, size_t *n, size_t *k, size_t *w,
-                          uint8_t **mat_h, size_t *len_h, uint8_t **mat_s,
-                          size_t *len_s) {
-  int ret = 0;
-  *n = 0;
-  *k = 0;
-  *w = 0;
-  size_t seed = 0;
-  int c;
-  FILE *file;
-  file = fopen(filename, "r");
-  if (file) {
-    skip_comment(file, &c);
-
-    /* Read n. */
-    if (!read_int(file, &c, n)) goto end;
-    *k = *n / 2;
-
-    skip_comment(file, &c);
-
-    /* Read seed. */
-    if (!read_int(file, &c, &seed)) goto end;
-
-    skip_comment(file, &c);
-
-    /* Read w. */
-    if (!read_int(file, &c, w)) goto end;
-
-    *mat_h = malloc(*k * *k * sizeof(uint8_t));
-
-    if (!mat_h) goto end;
-
-    skip_comment(file, &c);
+/*
+ * Parse an instance file. With ISD_PACK_CACHE set (to anything but an empty
+ * string), its packed copy FILE.pack is written the first time and read
+ * instead of the text afterwards.
+ */
+static int load_file(enum type type, const char *filename, size_t *n,
+                     size_t *k, size_t *w, uint64_t **mat_h, uint64_t **mat_s,
+                     size_t *nb_s) {
+  const char *cache = getenv("ISD_PACK_CACHE");
+  if (cache && *cache)
+    return parse_file_cached(type, filename, n, k, w, mat_h, mat_s, nb_s);
+  return parse_file(type, filename, n, k, w, mat_h, mat_s, nb_s);
+}
 
-    /* Read h. */
-    if (!read_bin_matrix(file, *k, &c, *mat_h, len_h)) goto end;
+#if DUMER_PROFILE
+/* Time and events of all the runs of the process. */
+static struct profile profile;
 
-    *mat_s = malloc(*k * sizeof(uint8_t));
+/*
+ * Write the profile of the runs so far to the file named by ISD_PROFILE, if
+ * it is set.
+ */
+static void save_profile(void) {
+  const char *path = getenv("ISD_PROFILE");
+  if (!path || !*path) return;
+  FILE *file = fopen(path, "w");
+  if (!file || !write_profile(&profile, file))
+    fprintf(stderr, "Cannot write the profile to %s.\n", path);
+  if (file) fclose(file);
+}
+#endif
 
-    if (!mat_s) goto end;
+#if DUMER_TRACE
+static int write_full(int fd, const void *buf, size_t len);
 
-    skip_comment(file, &c);
+/* Timeline of the threads, in the file named by ISD_TRACE. */
+static int trace_fd = -1;
 
-    /* Read s. */
-    if (!read_bin_vector(file, &c, *mat_s, len_s)) goto end;
-  } else {
-    return 0;
+/*
+ * Start the timeline, in the JSON array format of Chrome trace events: the
+ * closing bracket is optional, so the file can be read even if the process
+ * was interrupted.
+ */
+static void open_trace(void) {
+  const char *path = getenv("ISD_TRACE");
+  if (!path || !*path) return;
+  trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (trace_fd < 0) {
+    fprintf(stderr, "Cannot write the trace to %s.\n", path);
+    return;
   }
-  ret = 1;
+  char header[128];
+  int len = snprintf(header, sizeof(header),
+                     "[\n{\"name\": \"process_name\", \"ph\": \"M\", "
+                     "\"pid\": %ld, \"args\": {\"name\": \"isd\"}}",
+                     (long)getpid());
+  write_full(trace_fd, header, len);
+}
 
-end:
-  fclose(file);
-  return ret;
+static void close_trace(void) {
+  if (trace_fd < 0) return;
+  write_full(trace_fd, "\n]\n", 3);
+  close(trace_fd);
 }
 
-static int parse_input_go(char *filename, size_t *n, size_t *k, size_t *w,
-                          uint8_t **mat_h, size_t *len_h, uint8_t **mat_s,
-                          size_t *len_s) {
-  int ret = 0;
-  *n = 0;
-  *k = 0;
-  *w = 0;
-  int c;
-  FILE *file;
-  file = fopen(filename, "r");
-  if (file) {
-    skip_comment(file, &c);
+/*
+ * Append the events written by 'solver_trace' (of a solver) or 'isd_trace'
+ * (of the threads of a benchmark) in one write, so that the processes of a
+ * shard do not interleave them.
+ */
+static void append_trace(solver_t solver, isd_t *isd, int nb_threads) {
+  if (trace_fd < 0) return;
+  char *buf;
+  size_t len;
+  FILE *events = open_memstream(&buf, &len);
+  if (!events) return;
+  if (solver) write_solver_trace(solver, events);
+  for (int i = 0; i < nb_threads; ++i) {
+    write_trace(&isd[i]->trace, getpid(), i, events);
+  }
+  fclose(events);
+  write_full(trace_fd, buf, len);
+  free(buf);
+}
+#endif
 
-    /* Read n. */
-    if (!read_int(file, &c, n)) goto end;
+/* Gather what was measured during the last run of 'solver'. */
+static void collect_run(solver_t solver) {
+#if DUMER_PROFILE
+  add_profile(&profile, &solver->profile);
+#endif
+#if DUMER_TRACE
+  append_trace(solver, NULL, 0);
+#else
+  (void)(solver);
+#endif
+}
 
-    skip_comment(file, &c);
+/*
+ * Solve the instances of several files one after the other. The instances
+ * with the same length, dimension and number of syndromes share a solver,
+ * so that its tables and the data of its threads are only built once.
+ */
+static void solve_batch(int n_threads, enum type type, int nb_files,
+                        char **files) {
+  solver_cache_t cache = alloc_solver_cache();
+  if (!cache) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
 
-    /* Read k. */
-    if (!read_int(file, &c, k)) goto end;
+  for (int i = 0; i < nb_files; ++i) {
+    size_t n, k, w;
+    uint64_t *mat_h = NULL;
+    uint64_t *mat_s = NULL;
+    size_t nb_s = 0;
+    printf("file=%s\n", files[i]);
+    if (!load_file(type, files[i], &n, &k, &w, &mat_h, &mat_s, &nb_s)) {
+      fprintf(stderr, "Error parsing file %s.\n", files[i]);
+      free(mat_h);
+      free(mat_s);
+      continue;
+    }
+    print_parameters(n, k, w);
+
+    solver_t solver = cache_solver(cache, type, n, k, w, mat_h, mat_s, nb_s, 0);
+    free(mat_h);
+    free(mat_s);
+    if (!solver) {
+      fprintf(stderr, "Cannot decode %s with these parameters.\n", files[i]);
+      continue;
+    }
 
-    skip_comment(file, &c);
+    struct output out = {stdout, n};
+    if (run_solver(solver, n_threads, 0, print_solution, &out) < 0) {
+      fprintf(stderr, "Allocation error.\n");
+      exit(EXIT_FAILURE);
+    }
+    collect_run(solver);
+  }
 
-    /* Read w. */
-    if (!read_int(file, &c, w)) goto end;
+  free_solver_cache(cache);
+}
 
-    *mat_h = malloc(*n * *k * sizeof(uint8_t));
+/* Seconds a client has to send its instance. */
+#define SERVER_RECV_TIMEOUT 10
 
-    if (!mat_h) goto end;
+/*
+ * Solve the instance sent on a connection: a first line "TYPE [TIMEOUT [N1]]"
+ * followed by the instance in the usual format, up to the end of the input.
+ * The solutions are sent back as they are found, then a status line.
+ */
+static void solve_request(int n_threads, solver_cache_t cache, FILE *in,
+                          FILE *out) {
+  struct timespec start = timer_start();
+  const char *status = "error";
+  uint64_t nb_iterations = 0;
+  size_t page_size = 0;
+  char line[64];
+  char name[8];
+  double timeout = 0;
+  long n1 = 0;
+  enum type type;
+  size_t n, k, w;
+  uint64_t *mat_h = NULL;
+  uint64_t *mat_s = NULL;
+  size_t nb_s = 0;
+
+  if (!fgets(line, sizeof(line), in) ||
+      sscanf(line, "%7s %lf %ld", name, &timeout, &n1) < 1 ||
+      !parse_type(name, &type) || n1 < 0) {
+    fprintf(out, "error=request\n");
+    goto end;
+  }
+  /* The search for low-weight codewords only ends with its timeout. */
+  if (type == LW && timeout <= 0) {
+    fprintf(out, "error=timeout\n");
+    goto end;
+  }
+  if (!parse_input(type, in, &n, &k, &w, &mat_h, &mat_s, &nb_s)) {
+    fprintf(out, "error=instance\n");
+    goto end;
+  }
+  solver_t solver = cache_solver(cache, type, n, k, w, mat_h, mat_s, nb_s, n1);
+  if (!solver) {
+    fprintf(out, "error=parameters\n");
+    goto end;
+  }
 
-    skip_comment(file, &c);
+  struct output output = {out, n};
+  int ret = run_solver(solver, n_threads, timeout, print_solution, &output);
+  if (ret >= 0) status = ret ? "solved" : "stopped";
+  nb_iterations = solver->nb_iterations;
+  collect_run(solver);
+  page_size = solver_page_size(solver);
 
-    /* Read h. */
-    if (!read_bin_matrix(file, *k, &c, *mat_h, len_h)) goto end;
+end:
+  /*
+   * Closing with unread input would reset the connection before the reply,
+   * unless the client already stopped sending (and timed out).
+   */
+  if (!ferror(in))
+    while (getc(in) != EOF)
+      ;
+  fprintf(out, "status=%s time=%.3f iterations=%lu page_size=%lu\n", status,
+          timer_end(start) / 1e9, nb_iterations, page_size);
+  free(mat_h);
+  free(mat_s);
+}
 
-    *mat_s = malloc((*n - *k) * sizeof(uint8_t));
+/* Whether 'address' is "HOST:PORT" (TCP) rather than the path of a socket. */
+static int is_tcp(const char *address) {
+  return strchr(address, ':') && !strchr(address, '/');
+}
 
-    if (!mat_s) goto end;
+/* Resolve "HOST:PORT", or ":PORT" for any local address. */
+static struct addrinfo *resolve(const char *address, int passive) {
+  char host[256];
+  const char *port = strrchr(address, ':');
+  size_t len = port - address;
+  if (len >= sizeof(host)) return NULL;
+  memcpy(host, address, len);
+  host[len] = '\0';
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  struct addrinfo *res;
+  if (getaddrinfo(len ? host : NULL, port + 1, &hints, &res)) return NULL;
+  return res;
+}
 
-    skip_comment(file, &c);
+static int unix_address(const char *path, struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path)) return 0;
+  strcpy(addr->sun_path, path);
+  return 1;
+}
 
-    /* Read s. */
-    if (!read_bin_vector(file, &c, *mat_s, len_s)) goto end;
+/* Socket listening on 'address', or -1. */
+static int listen_on(const char *address) {
+  int sock = -1;
+  if (is_tcp(address)) {
+    struct addrinfo *res = resolve(address, 1);
+    if (!res) return -1;
+    sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    int on = 1;
+    if (sock >= 0 &&
+        (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+         bind(sock, res->ai_addr, res->ai_addrlen) < 0)) {
+      close(sock);
+      sock = -1;
+    }
+    freeaddrinfo(res);
   } else {
-    return 0;
+    struct sockaddr_un addr;
+    if (!unix_address(address, &addr)) return -1;
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(address);
+    if (sock >= 0 && bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(sock);
+      sock = -1;
+    }
+  }
+  if (sock >= 0 && listen(sock, 16) < 0) {
+    close(sock);
+    sock = -1;
   }
-  ret = 1;
+  return sock;
+}
 
-end:
-  fclose(file);
-  return ret;
+/* Socket connected to 'address', or -1. */
+static int connect_to(const char *address) {
+  int sock = -1;
+  if (is_tcp(address)) {
+    struct addrinfo *res = resolve(address, 0);
+    if (!res) return -1;
+    sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock >= 0 && connect(sock, res->ai_addr, res->ai_addrlen) < 0) {
+      close(sock);
+      sock = -1;
+    }
+    freeaddrinfo(res);
+  } else {
+    struct sockaddr_un addr;
+    if (!unix_address(address, &addr)) return -1;
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock >= 0 &&
+        connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(sock);
+      sock = -1;
+    }
+  }
+  return sock;
 }
 
-static int parse_input_qc(char *filename, size_t *n, size_t *k, size_t *w,
-                          uint8_t **mat_h, size_t *len_h, uint8_t **mat_s,
-                          size_t *len_s) {
-  int ret = 0;
-  *n = 0;
-  *k = 0;
-  *w = 0;
-  int c;
-  FILE *file;
-  file = fopen(filename, "r");
-  if (file) {
-    skip_comment(file, &c);
+static const char *socket_path;
 
-    /* Read n. */
-    if (!read_int(file, &c, n)) goto end;
-    *k = *n / 2;
+static void remove_socket(int sig) {
+  (void)(sig);
+  if (socket_path) unlink(socket_path);
+#if DUMER_TRACE
+  /* Only async-signal-safe calls here. */
+  if (trace_fd >= 0) write(trace_fd, "\n]\n", 3);
+#endif
+  _exit(EXIT_SUCCESS);
+}
 
-    skip_comment(file, &c);
+/*
+ * Answer the requests sent on 'address' (a Unix socket or "HOST:PORT"), one
+ * connection at a time, until the process is interrupted. The solvers of the
+ * last instances are kept, so that a series of instances of the same size
+ * only pays for the tables and buffers once.
+ */
+static void serve(int n_threads, const char *address) {
+  int sock = listen_on(address);
+  if (sock < 0) {
+    fprintf(stderr, "Cannot listen on %s.\n", address);
+    exit(EXIT_FAILURE);
+  }
+  socket_path = is_tcp(address) ? NULL : address;
+  signal(SIGINT, remove_socket);
+  signal(SIGTERM, remove_socket);
+  /* Clients leaving early must not kill the server. */
+  signal(SIGPIPE, SIG_IGN);
+
+  solver_cache_t cache = alloc_solver_cache();
+  if (!cache) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
 
-    /* Read w. */
-    if (!read_int(file, &c, w)) goto end;
+  for (;;) {
+    int fd = accept(sock, NULL, NULL);
+    if (fd < 0) continue;
+    struct timeval recv_timeout = {SERVER_RECV_TIMEOUT, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout,
+               sizeof(recv_timeout));
+    int fd_out = dup(fd);
+    FILE *in = fdopen(fd, "r");
+    FILE *out = (fd_out < 0) ? NULL : fdopen(fd_out, "w");
+    if (in && out) solve_request(n_threads, cache, in, out);
+#if DUMER_PROFILE
+    /* The daemon is only ever interrupted. */
+    save_profile();
+#endif
+    if (in)
+      fclose(in);
+    else
+      close(fd);
+    if (out)
+      fclose(out);
+    else if (fd_out >= 0)
+      close(fd_out);
+  }
+}
 
-    *mat_h = malloc(*k * sizeof(uint8_t));
+#if (BENCHMARK) <= 0
+/*
+ * Search with 'nb_procs' processes of 'n_threads' threads each, forked once
+ * the tables are built. They share the state of the search, so that the
+ * first solution found stops them all, and draw their information sets from
+ * disjoint random streams.
+ */
+static void solve_shards(solver_t solver, int nb_procs, int n_threads,
+                         size_t n) {
+  uint64_t S0, S1;
+  if (!share_solver(solver) || !seed_random(&S0, &S1)) {
+    fprintf(stderr, "Cannot share the search between processes.\n");
+    exit(EXIT_FAILURE);
+  }
+  /* Nothing buffered should be output by every process. */
+  fflush(stdout);
+
+#if DUMER_PROFILE
+  /* Each process leaves its profile there. */
+  struct profile *profiles =
+      mmap(NULL, nb_procs * sizeof(struct profile), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (profiles == MAP_FAILED) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
 
-    if (!mat_h) goto end;
+  int failed = 0;
+  for (int p = 0; p < nb_procs && !failed; ++p) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      seed_solver(solver, S0, S1, p);
+#if DUMER_NUMA
+      /* The processes are pinned on different CPUs, while there are some. */
+      solver->first_cpu = p * n_threads;
+#endif
+      struct output out = {stdout, n};
+      int ret = run_solver(solver, n_threads, 0, print_solution, &out);
+#if DUMER_PROFILE
+      profiles[p] = solver->profile;
+#endif
+#if DUMER_TRACE
+      /* All the processes append to the same file. */
+      append_trace(solver, NULL, 0);
+#endif
+      _exit(ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if (pid < 0) failed = 1;
+  }
+  if (failed) cancel_solver(solver);
+
+  int status;
+  while (wait(&status) > 0) {
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+      /* The others would never stop if the solution was its to find. */
+      cancel_solver(solver);
+      failed = 1;
+    }
+  }
+#if DUMER_PROFILE
+  for (int p = 0; p < nb_procs; ++p) {
+    add_profile(&profile, &profiles[p]);
+  }
+  munmap(profiles, nb_procs * sizeof(struct profile));
+#endif
+  if (failed) {
+    fprintf(stderr, "A process failed.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+#endif
 
-    skip_comment(file, &c);
+/* Read exactly 'len' bytes (0 if the connection ends before). */
+static int read_full(int fd, void *buf, size_t len) {
+  for (size_t done = 0; done < len;) {
+    ssize_t ret = read(fd, (char *)buf + done, len - done);
+    if (ret <= 0) return 0;
+    done += ret;
+  }
+  return 1;
+}
 
-    /* Read h. */
-    if (!read_bin_vector(file, &c, *mat_h, len_h)) goto end;
+static int write_full(int fd, const void *buf, size_t len) {
+  for (size_t done = 0; done < len;) {
+    ssize_t ret = write(fd, (const char *)buf + done, len - done);
+    if (ret <= 0) return 0;
+    done += ret;
+  }
+  return 1;
+}
 
-    *mat_s = malloc(*k * sizeof(uint8_t));
+/*
+ * Read a line without reading past it, so that what follows is still seen
+ * by 'poll'.
+ */
+static int read_line(int fd, char *line, size_t size) {
+  for (size_t len = 0; len + 1 < size; ++len) {
+    if (read(fd, &line[len], 1) != 1) return 0;
+    if (line[len] == '\n') {
+      line[len] = '\0';
+      return 1;
+    }
+  }
+  return 0;
+}
 
-    if (!mat_s) goto end;
+/* A worker of a coordinated search, and the end of its last line. */
+struct worker {
+  int fd;
+  char line[1 << 16];
+  size_t len;
+};
 
-    skip_comment(file, &c);
+/*
+ * Handle a line sent by a worker. Return 1 once the search is over: the
+ * first solution was found, or all the syndromes were decoded (DUMER_BATCH).
+ * Codewords are only output when they improve on the best weight found by
+ * any worker (DUMER_LW).
+ */
+static int coordinate_line(const char *line, size_t *w_best, int *solved,
+                           size_t nb_s, size_t *nb_solved) {
+  if (!strncmp(line, "status=", 7)) return 0;
+#if DUMER_LW
+  (void)(solved);
+  (void)(nb_s);
+  (void)(nb_solved);
+  size_t w = strtoul(line, NULL, 10);
+  if (w >= *w_best) return 0;
+  *w_best = w;
+#elif DUMER_BATCH
+  (void)(w_best);
+  size_t target = strtoul(line, NULL, 10);
+  if (target >= nb_s || solved[target]) return 0;
+  solved[target] = 1;
+  ++*nb_solved;
+#else
+  (void)(w_best);
+  (void)(solved);
+  (void)(nb_s);
+  (void)(nb_solved);
+#endif
+  printf("%s\n", line);
+  fflush(stdout);
+#if DUMER_LW
+  return 0;
+#elif DUMER_BATCH
+  return *nb_solved == nb_s;
+#else
+  return 1;
+#endif
+}
 
-    /* Read s. */
-    if (!read_bin_vector(file, &c, *mat_s, len_s)) goto end;
-  } else {
-    return 0;
+/*
+ * Hand the instance of 'filename' to 'nb_workers' processes connecting to
+ * 'address' (possibly from other hosts), each with its own random stream,
+ * output what they find and tell them all to stop once the instance is
+ * solved.
+ *
+ * A worker receives a line "TYPE N1 STREAM S0 S1 LENGTH" followed by the
+ * LENGTH bytes of the instance file, and sends back its solutions as they are
+ * found, then a status line. Anything it receives afterwards, or the end of
+ * the connection, stops its search.
+ */
+static void coordinate(const char *address, int nb_workers, const char *type,
+                       const char *filename, size_t n1, size_t nb_s) {
+  FILE *file = fopen(filename, "r");
+  char *instance = NULL;
+  size_t len = 0;
+  for (size_t size = 0; file && !feof(file);) {
+    if (len == size) {
+      size = size ? 2 * size : 1 << 16;
+      instance = realloc(instance, size);
+      if (!instance) break;
+    }
+    len += fread(instance + len, 1, size - len, file);
+  }
+  if (!file || !instance || ferror(file)) {
+    fprintf(stderr, "Error reading file.\n");
+    exit(EXIT_FAILURE);
   }
-  ret = 1;
-
-end:
   fclose(file);
-  return ret;
-}
 
-static int parse_input_lw(char *filename, size_t *n, size_t *k, size_t *w,
-                          uint8_t **mat_h, size_t *len_h) {
-  int ret = 0;
-  *n = 0;
-  *k = 0;
-  *w = 0;
-  size_t seed = 0;
-  int c;
-  FILE *file;
-  file = fopen(filename, "r");
-  if (file) {
-    skip_comment(file, &c);
-
-    /* Read n. */
-    if (!read_int(file, &c, n)) goto end;
-    *k = *n / 2;
-
-    skip_comment(file, &c);
+  uint64_t S0, S1;
+  int sock = listen_on(address);
+  struct worker *workers = calloc(nb_workers, sizeof(struct worker));
+  struct pollfd *fds = calloc(nb_workers, sizeof(struct pollfd));
+  int *solved = calloc(nb_s ? nb_s : 1, sizeof(int));
+  if (sock < 0 || !workers || !fds || !solved || !seed_random(&S0, &S1)) {
+    fprintf(stderr, "Cannot listen on %s.\n", address);
+    exit(EXIT_FAILURE);
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  for (int i = 0; i < nb_workers; ++i) {
+    char header[256];
+    workers[i].fd = accept(sock, NULL, NULL);
+    int header_len = snprintf(header, sizeof(header),
+                              "%s %lu %d %lu %lu %lu\n", type, n1, i, S0, S1,
+                              len);
+    if (workers[i].fd < 0 ||
+        !write_full(workers[i].fd, header, header_len) ||
+        !write_full(workers[i].fd, instance, len)) {
+      fprintf(stderr, "Cannot send the instance to a worker.\n");
+      exit(EXIT_FAILURE);
+    }
+    fds[i].fd = workers[i].fd;
+    fds[i].events = POLLIN;
+  }
+  close(sock);
+  if (!is_tcp(address)) unlink(address);
+  free(instance);
+
+  size_t w_best = SIZE_MAX;
+  size_t nb_solved = 0;
+  int nb_left = nb_workers;
+  int done = 0;
+  while (!done && nb_left > 0) {
+    if (poll(fds, nb_workers, -1) < 0) continue;
+    for (int i = 0; i < nb_workers && !done; ++i) {
+      if (!fds[i].revents) continue;
+      struct worker *worker = &workers[i];
+      ssize_t ret = read(worker->fd, worker->line + worker->len,
+                         sizeof(worker->line) - 1 - worker->len);
+      if (ret <= 0) {
+        close(worker->fd);
+        fds[i].fd = -1;
+        --nb_left;
+        continue;
+      }
+      worker->len += ret;
+      worker->line[worker->len] = '\0';
+      char *line = worker->line;
+      for (char *end; !done && (end = strchr(line, '\n')); line = end + 1) {
+        *end = '\0';
+        done = coordinate_line(line, &w_best, solved, nb_s, &nb_solved);
+      }
+      worker->len -= line - worker->line;
+      memmove(worker->line, line, worker->len);
+    }
+  }
 
-    /* Read seed. */
-    if (!read_int(file, &c, &seed)) goto end;
+  /* Broadcast the end of the search. */
+  for (int i = 0; i < nb_workers; ++i) {
+    if (fds[i].fd < 0) continue;
+    write_full(workers[i].fd, "stop\n", 5);
+    close(workers[i].fd);
+  }
+  free(workers);
+  free(fds);
+  free(solved);
+  if (!done) {
+    fprintf(stderr, "All the workers left before the end of the search.\n");
+    exit(EXIT_FAILURE);
+  }
+}
 
-    *mat_h = malloc(*k * *k * sizeof(uint8_t));
+/* What stops a worker: anything from its coordinator, or its leaving. */
+struct watch {
+  int fd;
+  solver_t solver;
+  atomic_int done;
+};
+
+static void *watch_coordinator(void *arg) {
+  struct watch *watch = arg;
+  struct pollfd fd = {watch->fd, POLLIN, 0};
+  int stop = 0;
+  while (!atomic_load(&watch->done)) {
+    if (!stop) stop = poll(&fd, 1, 100) > 0;
+    /* Again and again, in case the search was not started yet. */
+    if (stop) {
+      cancel_solver(watch->solver);
+      poll(NULL, 0, 100);
+    }
+  }
+  return NULL;
+}
 
-    if (!mat_h) goto end;
+/* Search for the coordinator listening on 'address' (see 'coordinate'). */
+static void work(int n_threads, const char *address) {
+  int fd = connect_to(address);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot connect to %s.\n", address);
+    exit(EXIT_FAILURE);
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  char header[256];
+  char name[8];
+  size_t n1, stream, len;
+  uint64_t S0, S1;
+  enum type type;
+  if (!read_line(fd, header, sizeof(header)) ||
+      sscanf(header, "%7s %lu %lu %lu %lu %lu", name, &n1, &stream, &S0, &S1,
+             &len) != 6 ||
+      !parse_type(name, &type)) {
+    fprintf(stderr, "Bad request from the coordinator.\n");
+    exit(EXIT_FAILURE);
+  }
+  char *instance = malloc(len ? len : 1);
+  if (!instance || !read_full(fd, instance, len)) {
+    fprintf(stderr, "Error receiving the instance.\n");
+    exit(EXIT_FAILURE);
+  }
 
-    skip_comment(file, &c);
+  size_t n, k, w;
+  uint64_t *mat_h = NULL;
+  uint64_t *mat_s = NULL;
+  size_t nb_s = 0;
+  if (!parse_buffer(type, instance, len, &n, &k, &w, &mat_h, &mat_s, &nb_s)) {
+    fprintf(stderr, "Error parsing the instance.\n");
+    exit(EXIT_FAILURE);
+  }
+  free(instance);
+  solver_t solver = alloc_solver(type, n, k, w, mat_h, mat_s, nb_s, n1);
+  FILE *out = fdopen(dup(fd), "w");
+  if (!solver || !out) {
+    fprintf(stderr, "Cannot decode the instance with these parameters.\n");
+    exit(EXIT_FAILURE);
+  }
+  free(mat_h);
+  free(mat_s);
+  seed_solver(solver, S0, S1, stream);
+
+  struct watch watch = {fd, solver, 0};
+  pthread_t watcher;
+  if (pthread_create(&watcher, NULL, watch_coordinator, &watch)) {
+    fprintf(stderr, "Cannot watch the coordinator.\n");
+    exit(EXIT_FAILURE);
+  }
+  struct timespec start = timer_start();
+  struct output output = {out, n};
+  int ret = run_solver(solver, n_threads, 0, print_solution, &output);
+  collect_run(solver);
+  atomic_store(&watch.done, 1);
+  pthread_join(watcher, NULL);
+  fprintf(out, "status=%s time=%.3f iterations=%lu\n",
+          ret < 0 ? "error" : (ret ? "solved" : "stopped"),
+          timer_end(start) / 1e9, solver->nb_iterations);
+  fclose(out);
+  close(fd);
+  free_solver(solver);
+  if (ret < 0) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+}
 
-    /* Read h. */
-    if (!read_bin_matrix(file, *k, &c, *mat_h, len_h)) goto end;
-  } else {
-    return 0;
+/*
+ * Remove a "--mem-limit SIZE" (or "--mem-limit=SIZE") option from the
+ * arguments, SIZE being in bytes or followed by K, M, G or T. Return the
+ * limit, or 0 without the option.
+ */
+static size_t parse_mem_limit(int *argc, char **argv) {
+  const char *option = "--mem-limit";
+  size_t len = strlen(option);
+  size_t limit = 0;
+  for (int i = 1; i < *argc; ++i) {
+    if (strncmp(argv[i], option, len)) continue;
+    const char *arg = argv[i] + len;
+    int nb_args = 1;
+    if (*arg == '=') {
+      ++arg;
+    } else if (*arg == '\0' && i + 1 < *argc) {
+      arg = argv[i + 1];
+      nb_args = 2;
+    } else {
+      continue;
+    }
+    char *end;
+    unsigned long long size = strtoull(arg, &end, 10);
+    const char *units = "KMGT";
+    const char *unit = (*end) ? strchr(units, *end) : NULL;
+    if (unit) {
+      size <<= 10 * (unit - units + 1);
+      ++end;
+    }
+    if (end == arg || *end || size == 0) {
+      fprintf(stderr, "Bad memory limit %s.\n", arg);
+      exit(EXIT_FAILURE);
+    }
+    limit = size;
+    memmove(&argv[i], &argv[i + nb_args],
+            (*argc - i - nb_args + 1) * sizeof(char *));
+    *argc -= nb_args;
+    --i;
   }
-  ret = 1;
+  return limit;
+}
 
-end:
-  fclose(file);
-  return ret;
+/* One thread per processor (shared by 'nb_procs' processes), by teams. */
+static int auto_threads(int nb_procs) {
+  int n_threads = omp_get_num_procs() / nb_procs;
+  n_threads -= n_threads % DUMER_ELIM_THREADS;
+  return (n_threads > 0) ? n_threads : DUMER_ELIM_THREADS;
+}
+
+#define MIB(bytes) ((bytes) / (double)(1 << 20))
+
+/* Print the memory 'n_threads' threads in each process will take. */
+static void print_memory(const struct solver_memory *memory, int n_threads,
+                         int nb_procs) {
+  const struct isd_memory *thread = &memory->thread;
+  printf("threads=%d memory=%.1fMiB\n", n_threads,
+         MIB(plan_total(memory, n_threads, nb_procs)));
+  printf("shared=%.1fMiB tables=%.1fMiB thread=%.1fMiB\n",
+         MIB(memory->shared), MIB(memory->tables), MIB(thread->total));
+  printf("matrices=%.1fMiB list1=%.1fMiB columns=%.1fMiB ",
+         MIB(thread->matrices), MIB(thread->list1), MIB(thread->columns));
+  printf("xor_rows=%.1fMiB other=%.1fMiB\n", MIB(thread->xor_rows),
+         MIB(thread->other));
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 4) {
+  /*
+   * In the other modes, the usual arguments are shifted by one, or by two
+   * for the argument following the mode in the shard and coordinate modes.
+   */
+  size_t mem_limit = parse_mem_limit(&argc, argv);
+#if DUMER_PROFILE
+  atexit(save_profile);
+#endif
+#if DUMER_TRACE
+  open_trace();
+  atexit(close_trace);
+#endif
+  const char *mode = (argc > 1) ? argv[1] : "";
+  int batch = !strcmp(mode, "batch");
+  int server = !strcmp(mode, "daemon");
+  int worker = !strcmp(mode, "work");
+  int packer = !strcmp(mode, "pack");
+  int shard = !strcmp(mode, "shard") && argc > 2;
+  int coordinator = !strcmp(mode, "coordinate") && argc > 2;
+  const char *mode_arg = (shard || coordinator) ? argv[2] : NULL;
+  int shift = batch + server + worker + packer + 2 * (shard + coordinator);
+  char *name = argv[0];
+  argc -= shift;
+  argv += shift;
+  if ((!batch && !server && !worker && !packer && argc != 4 &&
+       argc != 5) ||
+      (batch && argc < 4) || ((server || worker) && argc != 3) ||
+      (packer && argc != 3 && argc != 4)) {
     fprintf(stderr,
-            "Usage: %s [N_THREADS] [TYPE] [FILE]\n"
+            "Usage: %s [--mem-limit SIZE] [N_THREADS] [TYPE] [FILE] [N1]\n"
+            "       %s batch [N_THREADS] [TYPE] [FILE]...\n"
+            "       %s daemon [N_THREADS] [ADDRESS]\n"
+            "       %s shard [--mem-limit SIZE] [N_PROCS] [N_THREADS] [TYPE]\n"
+            "             [FILE] [N1]\n"
+            "       %s coordinate [ADDRESS] [N_WORKERS] [TYPE] [FILE] [N1]\n"
+            "       %s work [N_THREADS] [ADDRESS]\n"
+            "       %s pack [TYPE] [FILE] [PACKED]\n"
             "\n"
             "where TYPE is:\n"
             "         SD for syndrome decoding\n"
             "         QC for quasi-cyclic syndrome decoding\n"
             "         GO for Goppa codes syndrome decoding\n"
-            "         LW for low-weight codeword finding\n",
-            argv[0]);
+            "         LW for low-weight codeword finding\n"
+            "\n"
+            "and N1 (optional) is the number of columns the first list is\n"
+            "built from, out of the K + L columns of the birthday decoding\n"
+            "(half of them by default)\n"
+            "\n"
+            "N_THREADS set to 0 starts one thread per processor; with\n"
+            "--mem-limit, the number of threads is lowered until their\n"
+            "memory fits in SIZE bytes (or K, M, G, T)\n"
+            "\n"
+            "In batch mode, the files are solved one after the other,\n"
+            "reusing what was built for the previous instances\n"
+            "\n"
+            "In daemon mode, the instances are sent to ADDRESS (a Unix\n"
+            "socket, or HOST:PORT for TCP), each after a line\n"
+            "\"TYPE [TIMEOUT [N1]]\"\n"
+            "\n"
+            "In shard mode, N_PROCS processes search together; in coordinate\n"
+            "mode, it is the N_WORKERS processes started in work mode\n"
+            "\n"
+            "In pack mode, the instance is written in binary to PACKED\n"
+            "(FILE.pack by default), which can then be given as FILE; with\n"
+            "ISD_PACK_CACHE=1 in the environment, FILE.pack is written the\n"
+            "first time FILE is solved and used afterwards\n",
+            name, name, name, name, name, name, name);
     exit(EXIT_FAILURE);
   }
 
+  if (packer) {
+    enum type type;
+    char *packed = malloc(strlen(argv[2]) + sizeof(PACKED_SUFFIX));
+    if (!packed) {
+      fprintf(stderr, "Allocation error.\n");
+      exit(EXIT_FAILURE);
+    }
+    sprintf(packed, "%s%s", argv[2], PACKED_SUFFIX);
+    if (!parse_type(argv[1], &type) ||
+        !pack_file(type, argv[2], (argc == 4) ? argv[3] : packed)) {
+      fprintf(stderr, "Error packing file.\n");
+      exit(EXIT_FAILURE);
+    }
+    free(packed);
+    exit(EXIT_SUCCESS);
+  }
+
+  /* The number of workers takes the place of the number of threads. */
+  int n_threads = atoi(argv[1]);
+  if (n_threads < 0 || (coordinator && n_threads == 0)) {
+    fprintf(stderr, "N_THREADS should be greater than 0.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!coordinator && n_threads % DUMER_ELIM_THREADS) {
+    fprintf(stderr, "N_THREADS should be a multiple of DUMER_ELIM_THREADS.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (mem_limit && (batch || server || worker || coordinator)) {
+    fprintf(stderr, "--mem-limit only applies to one instance or shards.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if ((server || worker) && n_threads == 0) n_threads = auto_threads(1);
+  if (server) {
+    serve(n_threads, argv[2]);
+    exit(EXIT_SUCCESS);
+  }
+  if (worker) {
+    work(n_threads, argv[2]);
+    exit(EXIT_SUCCESS);
+  }
+  int nb_procs = shard ? atoi(mode_arg) : 1;
+  if (nb_procs <= 0) {
+    fprintf(stderr, "N_PROCS should be greater than 0.\n");
+    exit(EXIT_FAILURE);
+  }
+  int planned = (mem_limit || n_threads == 0);
+  if (!coordinator && n_threads == 0) n_threads = auto_threads(nb_procs);
+
   enum type current_type;
 
-  if (!strcmp(argv[2], "QC"))
-    current_type = QC;
-  else if (!strcmp(argv[2], "SD"))
-    current_type = SD;
-  else if (!strcmp(argv[2], "GO"))
-    current_type = GO;
-  else if (!strcmp(argv[2], "LW"))
-    current_type = LW;
-  else {
+  if (!parse_type(argv[2], &current_type)) {
     fprintf(stderr, "Check your arguments!\n");
     exit(EXIT_FAILURE);
   }
@@ -336,113 +1026,171 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
-  int n_threads = atoi(argv[1]);
-  if (n_threads < 0) {
-    fprintf(stderr, "N_THREADS should be greater than 0.\n");
+  if (batch) {
+#if DUMER_LW
+    /* The search for low-weight codewords never ends. */
+    fprintf(stderr, "No syndrome to decode in batch mode.\n");
     exit(EXIT_FAILURE);
+#endif
+    solve_batch(n_threads, current_type, argc - 3, argv + 3);
+    exit(EXIT_SUCCESS);
   }
 
   size_t n, k, w;
-  uint8_t *mat_h = NULL;
-  uint8_t *mat_s = NULL;
-  size_t len_h, len_s;
-
-  int parsed;
-  if (current_type == QC)
-    parsed =
-        parse_input_qc(argv[3], &n, &k, &w, &mat_h, &len_h, &mat_s, &len_s);
-  else if (current_type == SD)
-    parsed =
-        parse_input_sd(argv[3], &n, &k, &w, &mat_h, &len_h, &mat_s, &len_s);
-  else if (current_type == GO)
-    parsed =
-        parse_input_go(argv[3], &n, &k, &w, &mat_h, &len_h, &mat_s, &len_s);
-  else if (current_type == LW)
-    parsed = parse_input_lw(argv[3], &n, &k, &w, &mat_h, &len_h);
-
-  if (!parsed) {
+  uint64_t *mat_h = NULL;
+  uint64_t *mat_s = NULL;
+  size_t nb_s = 0;
+
+  if (!load_file(current_type, argv[3], &n, &k, &w, &mat_h, &mat_s, &nb_s)) {
     fprintf(stderr, "Error parsing file.\n");
     exit(EXIT_FAILURE);
   }
 
-  size_t r = n - k;
-
-  printf("n=%ld ", n);
-  printf("k=%ld ", k);
-  printf("w=%ld\n", w);
-  printf("l=%ld ", DUMER_L);
-  printf("p=%ld ", DUMER_P);
-  printf("epsilon=%ld ", DUMER_EPS);
-  printf("doom=%d\n", DUMER_DOOM);
+  print_parameters(n, k, w);
 
   /* Birthday decoding */
   size_t n1 = (k + DUMER_L) / 2;
+  if (argc == 5) {
+    int arg_n1 = atoi(argv[4]);
+    if (arg_n1 <= 0 || (size_t)arg_n1 >= k + DUMER_L) {
+      fprintf(stderr, "N1 should be between 1 and K + L - 1.\n");
+      exit(EXIT_FAILURE);
+    }
+    n1 = arg_n1;
+  }
   size_t n2 = k + DUMER_L - n1;
   if (DUMER_EPS > n2 || DUMER_EPS > n1) {
     fprintf(stderr, "Please lower DUMER_EPS.\n");
     exit(EXIT_FAILURE);
   }
+  if (n1 + DUMER_EPS < DUMER_P1 || n2 + DUMER_EPS < DUMER_P2 + 1) {
+    fprintf(stderr, "Too few columns for the weights of both lists.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (planned && !coordinator) {
+    struct solver_memory memory;
+    if (!plan_solver(&memory, n, k, nb_s, n1)) {
+      fprintf(stderr, "Cannot decode the instance with these parameters.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (mem_limit) {
+      n_threads = plan_threads(&memory, n_threads, nb_procs, mem_limit);
+      if (n_threads == 0) {
+        fprintf(stderr, "Not enough memory for %ld thread(s).\n",
+                (long)DUMER_ELIM_THREADS);
+        exit(EXIT_FAILURE);
+      }
+    }
+    print_memory(&memory, n_threads, nb_procs);
+  }
+
+  if (coordinator) {
+    free(mat_h);
+    free(mat_s);
+    coordinate(mode_arg, n_threads, argv[2], argv[3], n1, nb_s);
+    exit(EXIT_SUCCESS);
+  }
 
-  /* Data shared by all threads and computed only once */
-  shr_t shr = alloc_shr(n1, n2);
-  if (!shr) {
+  solver_t solver =
+      alloc_solver(current_type, n, k, w, mat_h, mat_s, nb_s, n1);
+  if (!solver) {
     fprintf(stderr, "Allocation error.\n");
     exit(EXIT_FAILURE);
   }
-  init_shr(shr, n, k, n1, n2);
+  if (mat_h) free(mat_h);
+  if (mat_s) free(mat_s);
+#if DUMER_NUMA
+  print_topology(solver->topology, 0, nb_procs * n_threads, stdout);
+#endif
 
 #if (BENCHMARK) <= 0
-#pragma omp parallel num_threads(n_threads)
-  {
-    isd_t isd = alloc_isd(n, k, r, n1, n2, shr->nb_combinations1, shr->k_opt);
-    if (!isd) {
+  if (shard) {
+    solve_shards(solver, nb_procs, n_threads, n);
+  } else {
+    struct output out = {stdout, n};
+    if (run_solver(solver, n_threads, 0, print_solution, &out) < 0) {
       fprintf(stderr, "Allocation error.\n");
       exit(EXIT_FAILURE);
     }
-    init_isd(isd, current_type, n, k, w, mat_h, mat_s);
-
-    while (1) {
-      int found = dumer(n, k, r, n1, n2, shr, isd);
-      if (found) {
-        print_solution(n, isd);
-#if !(DUMER_LW)
-        exit(EXIT_SUCCESS);
-#endif
-      }
-    }
-    free_isd(isd, r, n);
+    collect_run(solver);
   }
 #else
+  size_t r = n - k;
+  shr_t shr = solver->shr;
+#if (DUMER_ELIM_THREADS) > 1
+  team_t teams = alloc_teams(n_threads / DUMER_ELIM_THREADS);
+  if (!teams) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+#if DUMER_PIPELINE
+  pipeline_t pipe = alloc_pipeline(n_threads, k, r, n1, n2, nb_s);
+  if (!pipe) {
+    fprintf(stderr, "Allocation error.\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+
   isd_t *isd = malloc(n_threads * sizeof(isd_t));
   if (!isd) {
     fprintf(stderr, "Allocation error.\n");
     exit(EXIT_FAILURE);
   }
   for (int i = 0; i < n_threads; i++) {
-    isd[i] = alloc_isd(n, k, r, n1, n2, shr->nb_combinations1, shr->k_opt);
+    isd[i] = alloc_isd(n, k, r, n1, n2, shr->len_list1, solver->nb_targets,
+                       shr->k_opt, shr->nb_tables);
     if (!isd[i]) {
       fprintf(stderr, "Allocation error.\n");
       exit(EXIT_FAILURE);
     }
-    init_isd(isd[i], current_type, n, k, w, mat_h, mat_s);
+    init_isd(isd[i], solver->instance, n, w);
+    isd[i]->tables = shr->tables;
+#if (DUMER_ELIM_THREADS) > 1
+    join_team(isd[i], teams, i);
+#endif
   }
+  /* All the threads got the same pages, their data having the same size. */
+  printf("page_size=%lu\n", isd[0]->arena->page_size);
   struct timespec vartime = timer_start();  // begin a timer called 'vartime'
 #pragma omp parallel num_threads(n_threads)
   {
     int i = omp_get_thread_num();
-    for (size_t N = 0; N < (BENCHMARK + i) / n_threads; ++N) {
+#if DUMER_PIPELINE
+    /* Count the information sets searched by all the threads. */
+    while (pipeline_nb_searched(pipe) < (BENCHMARK)) {
+      dumer_pipeline(n, k, r, n1, n2, shr, pipe, isd[i], i);
+    }
+#else
+    /* All the threads of a team do the same number of iterations. */
+    int first = i - i % DUMER_ELIM_THREADS;
+    for (size_t N = 0; N < (BENCHMARK + first) / n_threads; ++N) {
       dumer(n, k, r, n1, n2, shr, isd[i]);
     }
+#endif
   }
   long time_elapsed_nanos = timer_end(vartime);
   printf("%ld\n", time_elapsed_nanos);
+#if DUMER_TRACE
+  append_trace(NULL, isd, n_threads);
+#endif
+#if DUMER_PIPELINE
+  /* The slots are handed back to the threads, so before freeing them. */
+  free_pipeline(pipe);
+#endif
   for (int i = 0; i < n_threads; i++) {
-    free_isd(isd[i], r, n);
+#if DUMER_PROFILE
+    add_profile(&profile, &isd[i]->profile);
+#endif
+    free_isd(isd[i]);
   }
+  free(isd);
+#if (DUMER_ELIM_THREADS) > 1
+  free(teams);
+#endif
 #endif
 
-  if (mat_h) free(mat_h);
-  if (mat_h) free(mat_s);
-  free_shr(shr);
+  free_solver(solver);
   exit(EXIT_SUCCESS);
 }
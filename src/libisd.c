@@ -0,0 +1,463 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "libisd.h"
+
+#include <omp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bits.h"
+#include "xoroshiro128plus.h"
+
+/* Number of syndromes decoded among the 'nb_targets' given. */
+static size_t solver_targets(size_t nb_targets) {
+#if DUMER_LW
+  (void)(nb_targets);
+  return 0;
+#elif !(DUMER_MULTI) && !(DUMER_BATCH)
+  /* Any other syndrome is ignored. */
+  return nb_targets ? 1 : 0;
+#else
+  return nb_targets;
+#endif
+}
+
+/*
+ * Number of columns list1 and list2 are built from, 'n1' being 0 for half of
+ * them. Return 0 if they do not fit the parameters.
+ */
+static int solver_columns(size_t k, size_t *n1, size_t *n2) {
+  if (*n1 == 0) *n1 = (k + DUMER_L) / 2;
+  if (*n1 >= k + DUMER_L) return 0;
+  *n2 = k + DUMER_L - *n1;
+  if (DUMER_EPS > *n2 || DUMER_EPS > *n1) return 0;
+  return *n1 + DUMER_EPS >= DUMER_P1 && *n2 + DUMER_EPS >= DUMER_P2 + 1;
+}
+
+solver_t alloc_solver(enum type type, size_t n, size_t k, size_t w,
+                      const uint64_t *mat_h, const uint64_t *mat_s,
+                      size_t nb_targets, size_t n1) {
+#if !(DUMER_LW)
+  if (type == LW || nb_targets == 0) return NULL;
+#endif
+  nb_targets = solver_targets(nb_targets);
+  if (k == 0 || k >= n) return NULL;
+
+  /* Birthday decoding */
+  size_t n2;
+  if (!solver_columns(k, &n1, &n2)) return NULL;
+
+  solver_t solver = malloc(sizeof(struct solver));
+  if (!solver) return NULL;
+  solver->n = n;
+  solver->k = k;
+  solver->n1 = n1;
+  solver->n2 = n2;
+  solver->nb_targets = nb_targets;
+  solver->nb_threads = 0;
+  solver->isd = NULL;
+  solver->nb_iterations = 0;
+  solver->seeded = 0;
+  solver->shr = NULL;
+#if DUMER_NUMA
+  solver->topology = NULL;
+  solver->replicas = NULL;
+#endif
+
+  solver->instance = alloc_instance(n, k, nb_targets);
+  if (!solver->instance) goto fail;
+#if DUMER_NUMA
+  solver->topology = alloc_topology(DUMER_NUMA, DUMER_ELIM_THREADS);
+  if (!solver->topology) goto fail;
+  solver->first_cpu = 0;
+  solver->replicas =
+      calloc(solver->topology->nb_nodes, sizeof(struct tables *));
+  if (!solver->replicas) goto fail;
+#endif
+
+  /* Data shared by all threads and computed only once */
+  solver->shr = alloc_shr(n1, n2, nb_targets);
+  if (!solver->shr) goto fail;
+  init_shr(solver->shr, n, k, n1, n2);
+
+  if (!load_solver(solver, type, w, mat_h, mat_s)) goto fail;
+  return solver;
+
+fail:
+  free_solver(solver);
+  return NULL;
+}
+
+int plan_solver(struct solver_memory *memory, size_t n, size_t k,
+                size_t nb_targets, size_t n1) {
+  nb_targets = solver_targets(nb_targets);
+  if (k == 0 || k >= n) return 0;
+  size_t n2;
+  if (!solver_columns(k, &n1, &n2)) return 0;
+  memory->n = n;
+  memory->k = k;
+  memory->n1 = n1;
+  memory->n2 = n2;
+  memory->nb_targets = nb_targets;
+
+  memory->shared = sizeof(struct solver) + instance_size(n, k, nb_targets) +
+                   sizeof(struct shared);
+#if DUMER_BATCH
+  memory->shared += nb_targets * sizeof(atomic_int);
+#endif
+  memory->tables = tables_size(n1);
+  memory->nb_nodes = 0;
+#if DUMER_NUMA
+  topology_t topology = alloc_topology(DUMER_NUMA, DUMER_ELIM_THREADS);
+  if (!topology) return 0;
+  memory->nb_nodes = topology->nb_nodes;
+  free_topology(topology);
+#endif
+  plan_isd(&memory->thread, n, k, n1, n2, nb_targets);
+  return 1;
+}
+
+size_t plan_total(const struct solver_memory *memory, size_t nb_threads,
+                  size_t nb_procs) {
+  size_t total = memory->shared + memory->tables;
+  size_t per_proc = nb_threads * (sizeof(isd_t) + memory->thread.total);
+#if DUMER_NUMA
+  /* The first thread on each node copies the tables there. */
+  size_t nb_replicas = nb_threads * nb_procs;
+  if (nb_replicas > memory->nb_nodes) nb_replicas = memory->nb_nodes;
+  total += nb_replicas * memory->tables;
+#endif
+#if DUMER_PIPELINE
+  per_proc += pipeline_size(nb_threads, memory->k, memory->n - memory->k,
+                            memory->n1, memory->n2, memory->nb_targets);
+#endif
+  return total + nb_procs * per_proc;
+}
+
+size_t plan_threads(const struct solver_memory *memory, size_t max_threads,
+                    size_t nb_procs, size_t limit) {
+  size_t nb_threads = max_threads - max_threads % DUMER_ELIM_THREADS;
+  while (nb_threads > 0 && plan_total(memory, nb_threads, nb_procs) > limit) {
+    nb_threads -= DUMER_ELIM_THREADS;
+  }
+  return nb_threads;
+}
+
+int load_solver(solver_t solver, enum type type, size_t w,
+                const uint64_t *mat_h, const uint64_t *mat_s) {
+#if !(DUMER_LW)
+  if (type == LW) return 0;
+#endif
+  solver->type = type;
+  solver->w = w;
+  /* Built once here, then only copied by each thread. */
+  if (!build_instance(solver->instance, type, solver->n, solver->k, mat_h,
+                      mat_s))
+    return 0;
+  reset_shr(solver->shr);
+  return 1;
+}
+
+/* Free the data of the threads of the previous runs. */
+static void free_threads(solver_t solver) {
+  for (size_t i = 0; i < solver->nb_threads; ++i) {
+    if (solver->isd[i]) free_isd(solver->isd[i]);
+  }
+  free(solver->isd);
+  solver->nb_threads = 0;
+  solver->isd = NULL;
+}
+
+/* Also frees a solver 'alloc_solver' could only partly allocate. */
+void free_solver(solver_t solver) {
+  free_threads(solver);
+  if (solver->instance) free_instance(solver->instance);
+#if DUMER_NUMA
+  for (size_t i = 0; solver->replicas && i < solver->topology->nb_nodes;
+       ++i) {
+    if (solver->replicas[i]) free_tables(solver->replicas[i]);
+  }
+  free(solver->replicas);
+  if (solver->topology) free_topology(solver->topology);
+#endif
+  if (solver->shr) free_shr(solver->shr);
+  free(solver);
+}
+
+size_t solver_page_size(solver_t solver) {
+  size_t page_size = 0;
+  for (size_t i = 0; i < solver->nb_threads; ++i) {
+    if (!solver->isd[i]) continue;
+    size_t size = solver->isd[i]->arena->page_size;
+    if (!page_size || size < page_size) page_size = size;
+  }
+  return page_size;
+}
+
+#if DUMER_TRACE
+int write_solver_trace(solver_t solver, FILE *file) {
+  int ok = 1;
+  for (size_t i = 0; i < solver->nb_threads; ++i) {
+    isd_t isd = solver->isd[i];
+    if (!isd) continue;
+    ok &= write_trace(&isd->trace, getpid(), i, file);
+    isd->trace.nb_events = 0;
+  }
+  return ok;
+}
+#endif
+
+void cancel_solver(solver_t solver) {
+  atomic_store_explicit(&solver->shr->stop, 1, memory_order_relaxed);
+}
+
+void seed_solver(solver_t solver, uint64_t S0, uint64_t S1, size_t stream) {
+  for (size_t i = 0; i < stream; ++i) {
+    long_jump(&S0, &S1);
+  }
+  solver->seeded = 1;
+  solver->S0 = S0;
+  solver->S1 = S1;
+  /* The threads are seeded when they are allocated again. */
+  free_threads(solver);
+}
+
+int share_solver(solver_t solver) {
+  shr_t shr = share_shr(solver->shr);
+  if (!shr) return 0;
+  solver->shr = shr;
+  return 1;
+}
+
+int run_solver(solver_t solver, size_t nb_threads, double timeout,
+               solution_callback_t callback, void *arg) {
+  if (nb_threads == 0 || nb_threads % DUMER_ELIM_THREADS) return -1;
+
+  size_t n = solver->n;
+  size_t k = solver->k;
+  size_t r = n - k;
+  size_t n1 = solver->n1;
+  size_t n2 = solver->n2;
+  shr_t shr = solver->shr;
+#if DUMER_BATCH
+  if (atomic_load(&shr->nb_solved) == shr->nb_targets) return 1;
+#endif
+
+  /* The processes sharing the state were forked with it reset. */
+  if (!shr->len_shared) {
+    atomic_store(&shr->stop, 0);
+#if !(DUMER_LW) && !(DUMER_BATCH)
+    atomic_store(&shr->reported, 0);
+#endif
+#if DUMER_LW_STREAM
+    atomic_store(&shr->error, 0);
+#endif
+  }
+  double deadline = omp_get_wtime() + timeout;
+
+  if (solver->nb_threads != nb_threads) {
+    free_threads(solver);
+    solver->isd = calloc(nb_threads, sizeof(isd_t));
+    if (!solver->isd) return -1;
+    solver->nb_threads = nb_threads;
+  }
+#if (DUMER_ELIM_THREADS) > 1
+  team_t teams = alloc_teams(nb_threads / DUMER_ELIM_THREADS);
+  if (!teams) return -1;
+#endif
+#if DUMER_PIPELINE
+  pipeline_t pipe =
+      alloc_pipeline(nb_threads, k, r, n1, n2, solver->nb_targets);
+  if (!pipe) return -1;
+#endif
+
+  int ret = 0;
+  int error = 0;
+  solver->nb_iterations = 0;
+#pragma omp parallel num_threads(nb_threads)
+  {
+    uint64_t nb_iterations = 0;
+    /* Each thread allocates its own data on its first run. */
+    size_t thread = omp_get_thread_num();
+#if DUMER_NUMA
+    /* Allocated once pinned, the data of the thread is on its node. */
+    size_t node = pin_thread(solver->topology, solver->first_cpu + thread);
+#endif
+    isd_t *isd_thread = &solver->isd[thread];
+    if (!*isd_thread) {
+      *isd_thread = alloc_isd(n, k, r, n1, n2, shr->len_list1,
+                              solver->nb_targets, shr->k_opt, shr->nb_tables);
+      if (*isd_thread && solver->seeded) {
+        (*isd_thread)->S0 = solver->S0;
+        (*isd_thread)->S1 = solver->S1;
+        for (size_t i = 0; i < thread; ++i) {
+          jump(&(*isd_thread)->S0, &(*isd_thread)->S1);
+        }
+      }
+    }
+    isd_t isd = *isd_thread;
+    if (isd) {
+      init_isd(isd, solver->instance, n, solver->w);
+#if DUMER_NUMA
+      /* The first thread of each node copies the tables there. */
+#pragma omp critical
+      if (!solver->replicas[node]) {
+        struct tables *tables = alloc_tables(n1);
+        if (tables) build_tables(tables, n1);
+        solver->replicas[node] = tables;
+      }
+      isd->tables = solver->replicas[node];
+      if (!isd->tables) {
+#pragma omp atomic write
+        error = 1;
+      }
+#else
+      isd->tables = shr->tables;
+#endif
+      isd->callback = callback;
+      isd->callback_arg = arg;
+      isd->deadline = timeout > 0 ? deadline : 0;
+#if DUMER_PROFILE
+      clear_profile(&isd->profile);
+#endif
+#if (DUMER_ELIM_THREADS) > 1
+      join_team(isd, teams, thread);
+#endif
+    } else {
+#pragma omp atomic write
+      error = 1;
+    }
+    /* Teams are complete and no thread failed once past this point. */
+#pragma omp barrier
+    while (!error) {
+#if (DUMER_ELIM_THREADS) > 1
+      /* The threads of a team eliminate together, so they stop together. */
+      if (isd->team_id == 0)
+        isd->team->stop =
+            atomic_load_explicit(&shr->stop, memory_order_relaxed);
+      matrix_team_barrier(&isd->team->elim);
+      if (isd->team->stop) break;
+#else
+      if (atomic_load_explicit(&shr->stop, memory_order_relaxed)) break;
+#endif
+
+#if DUMER_PIPELINE
+      int found = dumer_pipeline(n, k, r, n1, n2, shr, pipe, isd, thread);
+#else
+      int found = dumer(n, k, r, n1, n2, shr, isd);
+      ++nb_iterations;
+#endif
+#if DUMER_BATCH
+      /* The syndromes are reported as soon as they are decoded. */
+      if (found && atomic_load(&shr->nb_solved) == shr->nb_targets) {
+#pragma omp atomic write
+        ret = 1;
+        atomic_store(&shr->stop, 1);
+      }
+#elif DUMER_LW && !(DUMER_LW_STREAM)
+      if (found) report_solution(shr, isd);
+#elif !(DUMER_LW)
+      if (found) {
+        /* Only the first solution is reported. */
+        if (!atomic_exchange(&shr->reported, 1)) {
+          report_solution(shr, isd);
+#pragma omp atomic write
+          ret = 1;
+        }
+        atomic_store(&shr->stop, 1);
+      }
+#else
+      (void)(found);
+#endif
+      if (timeout > 0 && omp_get_wtime() > deadline)
+        atomic_store(&shr->stop, 1);
+    }
+#pragma omp atomic
+    solver->nb_iterations += nb_iterations;
+  }
+#if DUMER_LW_STREAM
+  /* A codeword found could not be recorded. */
+  if (atomic_load(&shr->error)) error = 1;
+#endif
+#if DUMER_PROFILE
+  clear_profile(&solver->profile);
+  for (size_t i = 0; i < nb_threads; ++i) {
+    if (solver->isd[i]) add_profile(&solver->profile, &solver->isd[i]->profile);
+  }
+#endif
+
+#if (DUMER_ELIM_THREADS) > 1
+  free(teams);
+#endif
+#if DUMER_PIPELINE
+  /* Only the information sets taken from the ring were searched. */
+  solver->nb_iterations = pipeline_nb_searched(pipe);
+  free_pipeline(pipe);
+#endif
+  return error ? -1 : ret;
+}
+
+solver_cache_t alloc_solver_cache(void) {
+  solver_cache_t cache = malloc(sizeof(struct solver_cache));
+  if (!cache) return NULL;
+  cache->nb_solvers = 0;
+  return cache;
+}
+
+void free_solver_cache(solver_cache_t cache) {
+  for (size_t i = 0; i < cache->nb_solvers; ++i) {
+    free_solver(cache->solvers[i]);
+  }
+  free(cache);
+}
+
+/* Move the 'i'-th solver of the cache to the front. */
+static void use_solver(solver_cache_t cache, size_t i, solver_t solver) {
+  memmove(&cache->solvers[1], &cache->solvers[0], i * sizeof(solver_t));
+  cache->solvers[0] = solver;
+}
+
+solver_t cache_solver(solver_cache_t cache, enum type type, size_t n,
+                      size_t k, size_t w, const uint64_t *mat_h,
+                      const uint64_t *mat_s, size_t nb_targets, size_t n1) {
+  size_t targets = solver_targets(nb_targets);
+  size_t n1_solver = n1, n2;
+  if (!solver_columns(k, &n1_solver, &n2)) return NULL;
+  for (size_t i = 0; i < cache->nb_solvers; ++i) {
+    solver_t solver = cache->solvers[i];
+    if (solver->n != n || solver->k != k || solver->nb_targets != targets ||
+        solver->n1 != n1_solver)
+      continue;
+    if (!load_solver(solver, type, w, mat_h, mat_s)) return NULL;
+    use_solver(cache, i, solver);
+    return solver;
+  }
+
+  solver_t solver = alloc_solver(type, n, k, w, mat_h, mat_s, nb_targets, n1);
+  if (!solver) return NULL;
+  /* The least recently used solver makes room for the new one. */
+  if (cache->nb_solvers == SOLVER_CACHE_SIZE)
+    free_solver(cache->solvers[--cache->nb_solvers]);
+  use_solver(cache, cache->nb_solvers++, solver);
+  return solver;
+}
@@ -0,0 +1,395 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "parse.h"
+
+#include <fcntl.h>
+#include <immintrin.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bits.h"
+
+/* Position in the text of an instance. */
+struct cursor {
+  const char *pos;
+  const char *end;
+};
+
+static void skip_comments(struct cursor *cur) {
+  while (cur->pos < cur->end && *cur->pos == '#') {
+    const char *eol = memchr(cur->pos, '\n', cur->end - cur->pos);
+    cur->pos = eol ? eol + 1 : cur->end;
+  }
+}
+
+/* Read the end of a line, or of the text. */
+static int read_eol(struct cursor *cur) {
+  if (cur->pos == cur->end) return 1;
+  if (*cur->pos != '\n') return 0;
+  ++cur->pos;
+  return 1;
+}
+
+static int read_int(struct cursor *cur, size_t *n) {
+  skip_comments(cur);
+  if (cur->pos == cur->end || *cur->pos == '\n') return 0;
+  *n = 0;
+  while (cur->pos < cur->end && *cur->pos >= '0' && *cur->pos <= '9') {
+    *n = 10 * *n + (*cur->pos++ - '0');
+  }
+  return read_eol(cur);
+}
+
+/*
+ * Pack a line of exactly 'len' characters '0' or '1'. They are compared 32 at
+ * a time, each comparison giving 32 bits of the line at once.
+ */
+static int read_line(struct cursor *cur, size_t len, uint64_t *line) {
+  if ((size_t)(cur->end - cur->pos) < len) return 0;
+  const char *pos = cur->pos;
+  const __m256i zero = _mm256_set1_epi8('0');
+  const __m256i one = _mm256_set1_epi8('1');
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i chars = _mm256_loadu_si256((const __m256i *)(pos + i));
+    __m256i ones = _mm256_cmpeq_epi8(chars, one);
+    __m256i zeros = _mm256_cmpeq_epi8(chars, zero);
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(ones, zeros)) !=
+        UINT32_MAX)
+      return 0;
+    uint32_t bits = _mm256_movemask_epi8(ones);
+    memcpy((uint32_t *)line + i / 32, &bits, sizeof(bits));
+  }
+  uint32_t bits = 0;
+  for (; i < len; ++i) {
+    if (pos[i] != '0' && pos[i] != '1') return 0;
+    bits |= (uint32_t)(pos[i] - '0') << (i % 32);
+  }
+  if (len % 32) memcpy((uint32_t *)line + len / 32, &bits, sizeof(bits));
+  cur->pos += len;
+  return read_eol(cur);
+}
+
+/* Zeroed packed lines, aligned on 256 bits. */
+static uint64_t *alloc_lines(size_t nb_lines, size_t len) {
+  size_t size = nb_lines * (AVX_PADDING(len) / 64) * sizeof(uint64_t);
+  uint64_t *lines = aligned_alloc(32, size ? size : 32);
+  if (lines) memset(lines, 0, size);
+  return lines;
+}
+
+static int read_lines(struct cursor *cur, size_t nb_lines, size_t len,
+                      uint64_t **lines) {
+  skip_comments(cur);
+  *lines = alloc_lines(nb_lines, len);
+  if (!*lines) return 0;
+  for (size_t j = 0; j < nb_lines; ++j) {
+    if (!read_line(cur, len, *lines + j * (AVX_PADDING(len) / 64))) return 0;
+  }
+  return 1;
+}
+
+/*
+ * Read at most 'max_s' syndromes of length 'r', one per line, up to the end
+ * of the text or an empty line.
+ */
+static int read_syndromes(struct cursor *cur, size_t r, size_t max_s,
+                          uint64_t **mat_s, size_t *nb_s) {
+  skip_comments(cur);
+  /* There is at most one syndrome per line left. */
+  size_t max_lines = (cur->end - cur->pos) / (r + 1) + 1;
+  if (max_s > max_lines) max_s = max_lines;
+  *mat_s = alloc_lines(max_s, r);
+  if (!*mat_s) return 0;
+  for (*nb_s = 0; *nb_s < max_s; ++*nb_s) {
+    if (*nb_s > 0 && (cur->pos == cur->end || *cur->pos == '\n')) break;
+    if (!read_line(cur, r, *mat_s + *nb_s * (AVX_PADDING(r) / 64))) return 0;
+  }
+  return 1;
+}
+
+static int parse_sd(struct cursor *cur, size_t *n, size_t *k, size_t *w,
+                    size_t *seed, uint64_t **mat_h, uint64_t **mat_s,
+                    size_t max_s, size_t *nb_s) {
+  if (!read_int(cur, n) || !read_int(cur, seed) || !read_int(cur, w))
+    return 0;
+  *k = *n / 2;
+  return read_lines(cur, *k, *n - *k, mat_h) &&
+         read_syndromes(cur, *n - *k, max_s, mat_s, nb_s);
+}
+
+static int parse_go(struct cursor *cur, size_t *n, size_t *k, size_t *w,
+                    uint64_t **mat_h, uint64_t **mat_s, size_t max_s,
+                    size_t *nb_s) {
+  if (!read_int(cur, n) || !read_int(cur, k) || !read_int(cur, w) ||
+      *k >= *n)
+    return 0;
+  return read_lines(cur, *k, *n - *k, mat_h) &&
+         read_syndromes(cur, *n - *k, max_s, mat_s, nb_s);
+}
+
+/* Only the first row of the circulant block is given. */
+static int parse_qc(struct cursor *cur, size_t *n, size_t *k, size_t *w,
+                    uint64_t **mat_h, uint64_t **mat_s, size_t max_s,
+                    size_t *nb_s) {
+  if (!read_int(cur, n) || !read_int(cur, w)) return 0;
+  *k = *n / 2;
+  return read_lines(cur, 1, *k, mat_h) &&
+         read_syndromes(cur, *k, max_s, mat_s, nb_s);
+}
+
+static int parse_lw(struct cursor *cur, size_t *n, size_t *k, size_t *w,
+                    size_t *seed, uint64_t **mat_h) {
+  if (!read_int(cur, n) || !read_int(cur, seed)) return 0;
+  *k = *n / 2;
+  *w = 0;
+  return read_lines(cur, *k, *n - *k, mat_h);
+}
+
+/* Number of words of the lines of 'mat_h' and of each syndrome. */
+static size_t words_h(enum type type, size_t n, size_t k) {
+  return (type == QC) ? AVX_PADDING(k) / 64 : k * (AVX_PADDING(n - k) / 64);
+}
+
+static size_t words_s(enum type type, size_t n, size_t k) {
+  size_t r = (type == QC) ? k : n - k;
+  return AVX_PADDING(r) / 64;
+}
+
+/* Copy the lines of a packed instance, checking its header first. */
+static int read_packed(enum type type, const char *buf, size_t len, size_t *n,
+                       size_t *k, size_t *w, size_t *seed, uint64_t **mat_h,
+                       uint64_t **mat_s, size_t max_s, size_t *nb_s) {
+  struct packed_header header;
+  if (len < sizeof(header)) return 0;
+  memcpy(&header, buf, sizeof(header));
+  /* Lengths this large could overflow the sizes below. */
+  if (header.type != (uint64_t)type || header.k == 0 ||
+      header.k >= header.n || header.n > UINT32_MAX ||
+      header.nb_s > UINT32_MAX)
+    return 0;
+  *n = header.n;
+  *k = header.k;
+  *w = header.w;
+  *seed = header.seed;
+  size_t len_h = words_h(type, *n, *k) * sizeof(uint64_t);
+  size_t len_s = words_s(type, *n, *k) * sizeof(uint64_t);
+  if (len - sizeof(header) < len_h ||
+      (len - sizeof(header) - len_h) / len_s < header.nb_s)
+    return 0;
+  *nb_s = (header.nb_s < max_s) ? header.nb_s : max_s;
+
+  *mat_h = aligned_alloc(32, len_h);
+  if (!*mat_h) return 0;
+  memcpy(*mat_h, buf + sizeof(header), len_h);
+  if (type == LW) return 1;
+  if (*nb_s == 0) return 0;
+  *mat_s = aligned_alloc(32, *nb_s * len_s);
+  if (!*mat_s) return 0;
+  memcpy(*mat_s, buf + sizeof(header) + len_h, *nb_s * len_s);
+  return 1;
+}
+
+/* Parse an instance either packed or in text, with its seed (0 if none). */
+static int parse_instance(enum type type, const char *buf, size_t len,
+                          size_t *n, size_t *k, size_t *w, size_t *seed,
+                          uint64_t **mat_h, uint64_t **mat_s, size_t max_s,
+                          size_t *nb_s) {
+  *n = 0;
+  *k = 0;
+  *w = 0;
+  *seed = 0;
+  *nb_s = 0;
+  if (len >= sizeof(PACKED_MAGIC) - 1 &&
+      !memcmp(buf, PACKED_MAGIC, sizeof(PACKED_MAGIC) - 1))
+    return read_packed(type, buf, len, n, k, w, seed, mat_h, mat_s, max_s,
+                       nb_s);
+
+  struct cursor cur = {buf, buf + len};
+  if (type == QC)
+    return parse_qc(&cur, n, k, w, mat_h, mat_s, max_s, nb_s);
+  else if (type == SD)
+    return parse_sd(&cur, n, k, w, seed, mat_h, mat_s, max_s, nb_s);
+  else if (type == GO)
+    return parse_go(&cur, n, k, w, mat_h, mat_s, max_s, nb_s);
+  else
+    return parse_lw(&cur, n, k, w, seed, mat_h);
+}
+
+/* Only the first syndrome is kept unless several can be decoded. */
+#if DUMER_MULTI || DUMER_BATCH
+#define MAX_SYNDROMES SIZE_MAX
+#else
+#define MAX_SYNDROMES 1
+#endif
+
+int parse_buffer(enum type type, const char *buf, size_t len, size_t *n,
+                 size_t *k, size_t *w, uint64_t **mat_h, uint64_t **mat_s,
+                 size_t *nb_s) {
+  size_t seed;
+  return parse_instance(type, buf, len, n, k, w, &seed, mat_h, mat_s,
+                        MAX_SYNDROMES, nb_s);
+}
+
+int parse_input(enum type type, FILE *file, size_t *n, size_t *k, size_t *w,
+                uint64_t **mat_h, uint64_t **mat_s, size_t *nb_s) {
+  char *buf = NULL;
+  size_t len = 0;
+  for (size_t size = 0; !feof(file) && !ferror(file);) {
+    if (len == size) {
+      size = size ? 2 * size : 1 << 16;
+      char *grown = realloc(buf, size);
+      if (!grown) break;
+      buf = grown;
+    }
+    len += fread(buf + len, 1, size - len, file);
+  }
+  int ret = feof(file) && !ferror(file) &&
+            parse_buffer(type, buf, len, n, k, w, mat_h, mat_s, nb_s);
+  free(buf);
+  return ret;
+}
+
+/* Map a whole file, read only. Return NULL if it is empty or missing. */
+static const char *map_file(const char *filename, size_t *len) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  void *buf = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (buf == MAP_FAILED) return NULL;
+  madvise(buf, st.st_size, MADV_SEQUENTIAL);
+  *len = st.st_size;
+  return buf;
+}
+
+int parse_file(enum type type, const char *filename, size_t *n, size_t *k,
+               size_t *w, uint64_t **mat_h, uint64_t **mat_s, size_t *nb_s) {
+  size_t len;
+  const char *buf = map_file(filename, &len);
+  if (!buf) return 0;
+  int ret = parse_buffer(type, buf, len, n, k, w, mat_h, mat_s, nb_s);
+  munmap((void *)buf, len);
+  return ret;
+}
+
+/*
+ * Write a packed instance to a temporary file renamed once complete, so that
+ * concurrent readers and writers of 'packed' only ever see a whole file.
+ */
+static int write_packed(const char *packed, enum type type, size_t n,
+                        size_t k, size_t w, size_t seed, const uint64_t *mat_h,
+                        const uint64_t *mat_s, size_t nb_s) {
+  struct packed_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PACKED_MAGIC, sizeof(header.magic));
+  header.type = type;
+  header.n = n;
+  header.k = k;
+  header.w = w;
+  header.seed = seed;
+  header.nb_s = nb_s;
+
+  size_t len_tmp = strlen(packed) + 32;
+  char *tmp = malloc(len_tmp);
+  if (!tmp) return 0;
+  snprintf(tmp, len_tmp, "%s.%ld.tmp", packed, (long)getpid());
+  FILE *file = fopen(tmp, "wb");
+  int ret = file != NULL;
+  if (file) {
+    size_t len_s = words_s(type, n, k);
+    ret = fwrite(&header, sizeof(header), 1, file) == 1 &&
+          fwrite(mat_h, sizeof(uint64_t), words_h(type, n, k), file) ==
+              words_h(type, n, k) &&
+          (nb_s == 0 ||
+           fwrite(mat_s, sizeof(uint64_t), nb_s * len_s, file) ==
+               nb_s * len_s);
+    ret = (fclose(file) == 0) && ret && rename(tmp, packed) == 0;
+    if (!ret) unlink(tmp);
+  }
+  free(tmp);
+  return ret;
+}
+
+int pack_file(enum type type, const char *filename, const char *packed) {
+  size_t len;
+  const char *buf = map_file(filename, &len);
+  if (!buf) return 0;
+  size_t n, k, w, seed, nb_s;
+  uint64_t *mat_h = NULL;
+  uint64_t *mat_s = NULL;
+  int ret = parse_instance(type, buf, len, &n, &k, &w, &seed, &mat_h, &mat_s,
+                           SIZE_MAX, &nb_s) &&
+            write_packed(packed, type, n, k, w, seed, mat_h, mat_s, nb_s);
+  munmap((void *)buf, len);
+  free(mat_h);
+  free(mat_s);
+  return ret;
+}
+
+int parse_file_cached(enum type type, const char *filename, size_t *n,
+                      size_t *k, size_t *w, uint64_t **mat_h,
+                      uint64_t **mat_s, size_t *nb_s) {
+  size_t len_packed = strlen(filename) + sizeof(PACKED_SUFFIX);
+  char *packed = malloc(len_packed);
+  if (!packed) return 0;
+  snprintf(packed, len_packed, "%s%s", filename, PACKED_SUFFIX);
+
+  /* The packed file is used as long as it is newer than the text. */
+  struct stat st_text, st_packed;
+  if (stat(filename, &st_text) == 0 && stat(packed, &st_packed) == 0 &&
+      (st_packed.st_mtim.tv_sec > st_text.st_mtim.tv_sec ||
+       (st_packed.st_mtim.tv_sec == st_text.st_mtim.tv_sec &&
+        st_packed.st_mtim.tv_nsec >= st_text.st_mtim.tv_nsec))) {
+    if (parse_file(type, packed, n, k, w, mat_h, mat_s, nb_s)) {
+      free(packed);
+      return 1;
+    }
+    free(*mat_h);
+    free(*mat_s);
+    *mat_h = NULL;
+    *mat_s = NULL;
+  }
+
+  size_t len;
+  const char *buf = map_file(filename, &len);
+  int ret = 0;
+  if (buf) {
+    size_t seed;
+    ret = parse_instance(type, buf, len, n, k, w, &seed, mat_h, mat_s,
+                         SIZE_MAX, nb_s);
+    munmap((void *)buf, len);
+    /* Failing to write the cache does not prevent solving the instance. */
+    if (ret) write_packed(packed, type, *n, *k, *w, seed, *mat_h, *mat_s,
+                          *nb_s);
+    if (*nb_s > MAX_SYNDROMES) *nb_s = MAX_SYNDROMES;
+  }
+  free(packed);
+  return ret;
+}
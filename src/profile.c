@@ -0,0 +1,73 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "profile.h"
+
+#include <string.h>
+
+#include "dumer.h"
+
+static const char *phase_names[PROFILE_NB_PHASES] = {
+    "shuffle",    "transpose", "echelonize", "extract",        "build_list",
+    "sort",       "build_lut", "xor_pairs",  "find_collisions"};
+
+static const char *counter_names[PROFILE_NB_COUNTERS] = {
+    "iterations", "chase_steps", "lut_probes",
+    "l_hits",     "full_checks", "early_aborts"};
+
+const char *profile_phase_name(enum profile_phase phase) {
+  return phase_names[phase];
+}
+
+void clear_profile(struct profile *profile) {
+  memset(profile, 0, sizeof(struct profile));
+}
+
+void add_profile(struct profile *total, const struct profile *profile) {
+  for (size_t i = 0; i < PROFILE_NB_PHASES; ++i) {
+    total->time[i] += profile->time[i];
+  }
+  for (size_t i = 0; i < PROFILE_NB_COUNTERS; ++i) {
+    total->count[i] += profile->count[i];
+  }
+}
+
+int write_profile(const struct profile *profile, FILE *file) {
+  fprintf(file, "{\n  \"parameters\": {");
+  fprintf(file, "\"l\": %ld, \"p\": %ld, \"p1\": %ld, \"epsilon\": %ld, ",
+          (long)DUMER_L, (long)DUMER_P, (long)DUMER_P1, (long)DUMER_EPS);
+  fprintf(file, "\"lut\": %ld, \"elim_threads\": %ld},\n", (long)DUMER_LUT,
+          (long)DUMER_ELIM_THREADS);
+
+  /* Time summed over the threads. */
+  fprintf(file, "  \"time_ns\": {");
+  for (size_t i = 0; i < PROFILE_NB_PHASES; ++i) {
+    fprintf(file, "%s\"%s\": %lu", i ? ", " : "", profile_phase_name(i),
+            profile->time[i]);
+  }
+  fprintf(file, "},\n  \"counts\": {");
+  for (size_t i = 0; i < PROFILE_NB_COUNTERS; ++i) {
+    fprintf(file, "%s\"%s\": %lu", i ? ", " : "", counter_names[i],
+            profile->count[i]);
+  }
+  fprintf(file, "}\n}\n");
+  return !ferror(file);
+}
@@ -1,53 +1,39 @@
 #include "sort.h"
 
+#include <string.h>
+
 #define RADIX 8
 #define BUCKETS (1L << RADIX)
+/* Bytes of the keys above DUMER_L are always zero. */
+#define NB_PASSES (((DUMER_L) + RADIX - 1) / RADIX)
 
 /* LSD radix sort */
 void sort(SORT_TYPE *restrict array, size_t *restrict idx,
           SORT_TYPE *restrict aux, size_t *restrict aux_idx, size_t len) {
   const size_t stride = SORT_WIDTH / RADIX;
-  size_t count[8][BUCKETS + 1] = {0};
+  size_t count[NB_PASSES][BUCKETS + 1] = {0};
+  int constant[NB_PASSES];
 
   {
     uint8_t *restrict array8 = ((uint8_t *)array);
     for (size_t i = 0; i < len; ++i) {
-      ++count[0][array8[0] + 1];
-#if SORT_WIDTH >= 16
-      ++count[1][array8[1] + 1];
-#endif
-#if SORT_WIDTH >= 32
-      ++count[2][array8[2] + 1];
-      ++count[3][array8[3] + 1];
-#endif
-#if SORT_WIDTH == 64
-      ++count[4][array8[4] + 1];
-      ++count[5][array8[5] + 1];
-      ++count[6][array8[6] + 1];
-      ++count[7][array8[7] + 1];
-#endif
+      for (size_t w = 0; w < NB_PASSES; ++w) ++count[w][array8[w] + 1];
       array8 += stride;
     }
   }
 
+  /* A byte which is the same for all keys does not need a pass. */
+  for (size_t w = 0; w < NB_PASSES; ++w)
+    constant[w] = len == 0 || count[w][((uint8_t *)array)[w] + 1] == len;
+
   for (size_t j = 1; j < BUCKETS - 1; ++j) {
-    count[0][j + 1] += count[0][j];
-#if SORT_WIDTH >= 16
-    count[1][j + 1] += count[1][j];
-#endif
-#if SORT_WIDTH >= 32
-    count[2][j + 1] += count[2][j];
-    count[3][j + 1] += count[3][j];
-#endif
-#if SORT_WIDTH == 64
-    count[4][j + 1] += count[4][j];
-    count[5][j + 1] += count[5][j];
-    count[6][j + 1] += count[6][j];
-    count[7][j + 1] += count[7][j];
-#endif
+    for (size_t w = 0; w < NB_PASSES; ++w) count[w][j + 1] += count[w][j];
   }
 
-  for (size_t w = 0; w < SORT_WIDTH / RADIX; w++) {
+  SORT_TYPE *orig_array = array;
+  size_t *orig_idx = idx;
+  for (size_t w = 0; w < NB_PASSES; w++) {
+    if (constant[w]) continue;
     uint8_t *restrict array8 = ((uint8_t *)array) + w;
     for (size_t i = 0; i < len; ++i) {
       uint8_t byte = array8[stride * i];
@@ -57,8 +43,6 @@ void sort(SORT_TYPE *restrict array, size_t *restrict idx,
       ++(*cnt);
     }
 
-    /* No need to copy the array as we always do an even number of
-     * iterations when SORT_WIDTH >= 16. */
     {
       SORT_TYPE *swp = array;
       array = aux;
@@ -70,10 +54,10 @@ void sort(SORT_TYPE *restrict array, size_t *restrict idx,
       aux_idx = swp;
     }
   }
-#if SORT_WIDTH == 8
-  for (size_t i = 0; i < len; ++i) {
-    aux[i] = array[i];
-    aux_idx[i] = idx[i];
+
+  /* After an odd number of passes, the result is in the auxiliary arrays. */
+  if (array != orig_array) {
+    memcpy(orig_array, array, len * sizeof(SORT_TYPE));
+    memcpy(orig_idx, idx, len * sizeof(size_t));
   }
-#endif
 }
@@ -0,0 +1,213 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+/* For the CPU affinity of threads. */
+#define _GNU_SOURCE
+#include "topology.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+#define SYSFS_NODES "/sys/devices/system/node/online"
+#define SYSFS_NODE_CPUS "/sys/devices/system/node/node%d/cpulist"
+#define SYSFS_CPU_ID "/sys/devices/system/cpu/cpu%d/topology/%s"
+
+/* Read a list of CPUs (or nodes) such as "0-3,8,10-11". */
+static int read_list(const char *path, cpu_set_t *set) {
+  FILE *file = fopen(path, "r");
+  if (!file) return 0;
+  CPU_ZERO(set);
+  unsigned first, last;
+  while (fscanf(file, "%u", &first) == 1) {
+    last = first;
+    int c = getc(file);
+    if (c == '-') {
+      if (fscanf(file, "%u", &last) != 1) break;
+      c = getc(file);
+    }
+    for (unsigned i = first; i <= last && i < CPU_SETSIZE; ++i) {
+      CPU_SET(i, set);
+    }
+    if (c != ',') break;
+  }
+  fclose(file);
+  return 1;
+}
+
+/* Identifier of the package or core of a CPU, -1 if unknown. */
+static long read_id(int cpu, const char *name) {
+  char path[128];
+  snprintf(path, sizeof(path), SYSFS_CPU_ID, cpu, name);
+  FILE *file = fopen(path, "r");
+  long id = -1;
+  if (file) {
+    if (fscanf(file, "%ld", &id) != 1) id = -1;
+    fclose(file);
+  }
+  return id;
+}
+
+struct cpu {
+  int cpu;
+  size_t node;
+  long package;
+  long core;
+  /* Rank among the hardware threads of its core. */
+  size_t sibling;
+};
+
+#define COMPARE(x, y) \
+  if ((x) != (y)) return ((x) > (y)) - ((x) < (y))
+
+static int compare_cpus(const void *a, const void *b) {
+  const struct cpu *x = a;
+  const struct cpu *y = b;
+  COMPARE(x->node, y->node);
+  COMPARE(x->sibling, y->sibling);
+  COMPARE(x->package, y->package);
+  COMPARE(x->core, y->core);
+  return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+/* Add the CPUs of 'set' allowed for this process to 'node'. */
+static void add_node(struct cpu *cpus, size_t *nb_cpus, cpu_set_t *allowed,
+                     cpu_set_t *set, size_t node) {
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, set) || !CPU_ISSET(cpu, allowed)) continue;
+    CPU_CLR(cpu, allowed);
+    cpus[*nb_cpus].cpu = cpu;
+    cpus[*nb_cpus].node = node;
+    cpus[*nb_cpus].package = read_id(cpu, "physical_package_id");
+    cpus[*nb_cpus].core = read_id(cpu, "core_id");
+    ++*nb_cpus;
+  }
+}
+
+topology_t alloc_topology(size_t threads_per_core, size_t group) {
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed)) return NULL;
+  topology_t topology = malloc(sizeof(struct topology));
+  struct cpu *cpus = malloc(CPU_COUNT(&allowed) * sizeof(struct cpu));
+  if (!topology || !cpus) {
+    free(topology);
+    free(cpus);
+    return NULL;
+  }
+
+  /* Memory-only nodes have no CPU and are skipped. */
+  size_t nb_cpus = 0;
+  size_t nb_nodes = 0;
+  cpu_set_t nodes;
+  cpu_set_t set;
+  if (read_list(SYSFS_NODES, &nodes)) {
+    for (int node = 0; node < CPU_SETSIZE; ++node) {
+      char path[128];
+      snprintf(path, sizeof(path), SYSFS_NODE_CPUS, node);
+      if (!CPU_ISSET(node, &nodes) || !read_list(path, &set)) continue;
+      size_t nb_before = nb_cpus;
+      add_node(cpus, &nb_cpus, &allowed, &set, nb_nodes);
+      if (nb_cpus > nb_before) ++nb_nodes;
+    }
+  }
+  /* Without NUMA, or for CPUs in no node, all of them are on one node. */
+  if (CPU_COUNT(&allowed)) {
+    CPU_ZERO(&set);
+    CPU_OR(&set, &set, &allowed);
+    add_node(cpus, &nb_cpus, &allowed, &set, nb_nodes++);
+  }
+
+  /* Keep the first hardware threads of each core. */
+  size_t nb_kept = 0;
+  for (size_t i = 0; i < nb_cpus; ++i) {
+    cpus[i].sibling = 0;
+    for (size_t j = 0; j < i && cpus[i].core >= 0; ++j) {
+      if (cpus[j].node == cpus[i].node && cpus[j].package == cpus[i].package &&
+          cpus[j].core == cpus[i].core)
+        ++cpus[i].sibling;
+    }
+  }
+  for (size_t i = 0; i < nb_cpus; ++i) {
+    if (cpus[i].sibling < threads_per_core) cpus[nb_kept++] = cpus[i];
+  }
+  qsort(cpus, nb_kept, sizeof(struct cpu), compare_cpus);
+
+  /* Take 'group' CPUs from each node in turn. */
+  topology->nb_cpus = nb_kept;
+  topology->nb_nodes = nb_nodes;
+  topology->cpus = malloc(nb_kept * sizeof(int));
+  topology->nodes = malloc(nb_kept * sizeof(size_t));
+  size_t *next = malloc(nb_nodes * sizeof(size_t));
+  if (!topology->cpus || !topology->nodes || !next) {
+    free_topology(topology);
+    free(next);
+    free(cpus);
+    return NULL;
+  }
+  for (size_t i = nb_kept; i-- > 0;) {
+    next[cpus[i].node] = i;
+  }
+  for (size_t i = 0; i < nb_kept;) {
+    for (size_t node = 0; node < nb_nodes; ++node) {
+      for (size_t j = 0; j < group && next[node] < nb_kept &&
+                         cpus[next[node]].node == node;
+           ++j, ++next[node], ++i) {
+        topology->cpus[i] = cpus[next[node]].cpu;
+        topology->nodes[i] = node;
+      }
+    }
+  }
+  free(next);
+  free(cpus);
+  return topology;
+}
+
+void free_topology(topology_t topology) {
+  free(topology->cpus);
+  free(topology->nodes);
+  free(topology);
+}
+
+size_t pin_thread(topology_t topology, size_t thread) {
+  size_t i = thread % topology->nb_cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(topology->cpus[i], &set);
+  sched_setaffinity(0, sizeof(set), &set);
+  return topology->nodes[i];
+}
+
+void print_topology(topology_t topology, size_t first, size_t nb_threads,
+                    FILE *file) {
+  fprintf(file, "numa_nodes=%ld cpus=%ld\n", topology->nb_nodes,
+          topology->nb_cpus);
+  /* Each thread as THREAD:CPU, on the line of its node. */
+  for (size_t node = 0; node < topology->nb_nodes; ++node) {
+    const char *sep = "threads=";
+    for (size_t t = first; t < first + nb_threads; ++t) {
+      size_t i = t % topology->nb_cpus;
+      if (topology->nodes[i] != node) continue;
+      if (*sep == 't') fprintf(file, "node=%ld ", node);
+      fprintf(file, "%s%ld:%d", sep, t - first, topology->cpus[i]);
+      sep = ",";
+    }
+    if (*sep == ',') fprintf(file, "\n");
+  }
+}
@@ -0,0 +1,37 @@
+/*
+   Copyright (c) 2019 Valentin Vasseur
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to
+   deal in the Software without restriction, including without limitation the
+   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+   sell copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+   IN THE SOFTWARE
+*/
+#include "trace.h"
+
+int write_trace(const struct trace *trace, long pid, size_t tid, FILE *file) {
+  uint64_t first = 0;
+  if (trace->nb_events > trace->size) first = trace->nb_events - trace->size;
+  for (uint64_t i = first; i < trace->nb_events; ++i) {
+    const struct trace_event *event = &trace->events[i % trace->size];
+    /* Complete events, with their time and duration in microseconds. */
+    fprintf(file,
+            ",\n{\"name\": \"%s\", \"cat\": \"isd\", \"ph\": \"X\", "
+            "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %ld, \"tid\": %lu}",
+            profile_phase_name(event->phase), event->begin / 1e3,
+            (event->end - event->begin) / 1e3, pid, tid);
+  }
+  return !ferror(file);
+}
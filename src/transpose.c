@@ -24,11 +24,14 @@
 #include <immintrin.h>
 
 /* Transpose a bit-matrix using the vpmovmskb instruction.
+ *
+ * Blocks of 32x8 bits are gathered one byte at a time. This is the reference
+ * kernel, 'matrix_transpose' is faster.
  *
  * See Bitshuffle - https://github.com/kiyo-masui/bitshuffle (MIT)
  * Copyright (c) 2014 Kiyoshi Masui (kiyo@physics.ubc.ca) */
-void matrix_transpose(matrix_t At, const matrix_t A, const size_t nrows,
-                      const size_t ncols) {
+void matrix_transpose_32x8(matrix_t At, const matrix_t A, const size_t nrows,
+                           const size_t ncols) {
   __m256i vec_x;
 
   int8_t in[32] __attribute__((aligned(32)));
@@ -55,6 +58,75 @@ void matrix_transpose(matrix_t At, const matrix_t A, const size_t nrows,
   }
 }
 
+/* Exchange the j x j sub-blocks of a 64x64 bit-block lying on either side of
+ * the diagonal (Hacker's Delight, section 7-3). Four blocks are processed at
+ * once, one per 64-bit lane. */
+static inline __attribute__((always_inline)) void transpose_step(
+    __m256i *t, const unsigned j, const uint64_t mask) {
+  const __m256i m = _mm256_set1_epi64x(mask);
+  for (unsigned i = 0; i < 64; i = (i + j + 1) & ~j) {
+    __m256i x = _mm256_and_si256(
+        _mm256_xor_si256(_mm256_srli_epi64(t[i], j), t[i + j]), m);
+    t[i + j] = _mm256_xor_si256(t[i + j], x);
+    t[i] = _mm256_xor_si256(t[i], _mm256_slli_epi64(x, j));
+  }
+}
+
+static inline void transpose_64x64x4(__m256i *t) {
+  transpose_step(t, 32, 0x00000000ffffffffUL);
+  transpose_step(t, 16, 0x0000ffff0000ffffUL);
+  transpose_step(t, 8, 0x00ff00ff00ff00ffUL);
+  transpose_step(t, 4, 0x0f0f0f0f0f0f0f0fUL);
+  transpose_step(t, 2, 0x3333333333333333UL);
+  transpose_step(t, 1, 0x5555555555555555UL);
+}
+
+/* Transpose columns 'cstart' to 'cstart + ncols - 1' of a bit-matrix by tiles
+ * of 64 rows and 256 columns.
+ *
+ * A whole 256-bit chunk of each row is loaded, so a tile holds four 64x64
+ * blocks side by side that are transposed in registers.
+ *
+ * 'cstart' must be a multiple of WORD_SIZE. Row 'c' of At is column
+ * 'cstart + c' of A. As with 'matrix_transpose_32x8', rows of A are read up to
+ * the next multiple of 32. */
+void matrix_transpose_block(matrix_t At, const matrix_t A, const size_t nrows,
+                            const size_t cstart, const size_t ncols) {
+  __m256i t[64];
+  const size_t nrows_read = (nrows + 31) / 32 * 32;
+  const size_t wstart = cstart / WORD_SIZE;
+
+  for (size_t i = 0; i < nrows_read; i += 64) {
+    size_t rows_tile = (nrows_read - i < 64) ? nrows_read - i : 64;
+    for (size_t j = 0; j < ncols; j += 256) {
+      size_t cols_tile = (ncols - j < 256) ? ncols - j : 256;
+      /* Do not read past the last word holding a wanted column. */
+      size_t words_tile = (cols_tile + WORD_SIZE - 1) / WORD_SIZE;
+      __m256i load_mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(words_tile),
+                                             _mm256_set_epi64x(3, 2, 1, 0));
+      for (size_t k = 0; k < rows_tile; ++k) {
+        t[k] = _mm256_maskload_epi64(
+            (long long *)(A[i + k] + wstart + j / WORD_SIZE), load_mask);
+      }
+      for (size_t k = rows_tile; k < 64; ++k) {
+        t[k] = _mm256_setzero_si256();
+      }
+
+      transpose_64x64x4(t);
+
+      for (size_t c = 0; c < cols_tile; ++c) {
+        At[j + c][i / WORD_SIZE] = ((uint64_t *)&t[c % 64])[c / 64];
+      }
+    }
+  }
+}
+
+/* Transpose a bit-matrix. See 'matrix_transpose_block'. */
+void matrix_transpose(matrix_t At, const matrix_t A, const size_t nrows,
+                      const size_t ncols) {
+  matrix_transpose_block(At, A, nrows, 0, ncols);
+}
+
 /* Reverse the rows of a matrix.
  *
  * Modify the matrix in place. */
@@ -85,3 +157,27 @@ void matrix_transpose_rev_rows(matrix_t At, matrix_t A, const size_t nrows,
   matrix_transpose(At, A, nrows, ncols);
   matrix_reverse_rows(At, ncols);
 }
+
+/* Same as 'matrix_transpose_rev_cols' when column 'i' of A is the 'i'-th unit
+ * vector for all 'i' < 'npivots', as is the case after a partial Gaussian
+ * elimination.
+ *
+ * Only the remaining columns (from the last multiple of WORD_SIZE not greater
+ * than 'npivots') are actually transposed. */
+void matrix_transpose_rev_cols_echelon(matrix_t At, matrix_t A,
+                                       const size_t nrows, const size_t ncols,
+                                       const size_t npivots) {
+  const size_t cstart = npivots / WORD_SIZE * WORD_SIZE;
+  const size_t nwords = (nrows + WORD_SIZE - 1) / WORD_SIZE;
+
+  for (size_t c = 0; c < cstart; ++c) {
+    for (size_t i = 0; i < nwords; ++i) {
+      At[c][i] = 0;
+    }
+    At[c][(nrows - 1 - c) / WORD_SIZE] = (word_t)1
+                                         << ((nrows - 1 - c) % WORD_SIZE);
+  }
+
+  matrix_reverse_rows(A, nrows);
+  matrix_transpose_block(At + cstart, A, nrows, cstart, ncols - cstart);
+}